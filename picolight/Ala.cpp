@@ -16,6 +16,8 @@
   <http://www.gnu.org/licenses/>.
 --------------------------------------------------------------------*/
 
+#include <stdlib.h>
+
 #include "Ala.h"
 
 
@@ -23,37 +25,41 @@ AlaColor alaPalNull_[] = { };
 AlaPalette alaPalNull = { 0, alaPalNull_ };
 
 // Red,Green,Blue sequence
-AlaColor alaPalRgb_[] = { 0xFF0000, 0x00FF00, 0x0000FF };
-AlaPalette alaPalRgb = { 3, alaPalRgb_ };
+constexpr AlaColor alaPalRgb_[] = { 0xFF0000, 0x00FF00, 0x0000FF };
+constexpr AlaPaletteLut alaPalRgb__ = alaMakePaletteLut(alaPalRgb_);
+AlaPalette alaPalRgb = { 3, alaPalRgb_, alaPalRgb__.colors };
 
 // Rainbow colors
-AlaColor alaPalRainbow_[] =
+constexpr AlaColor alaPalRainbow_[] =
 {
     0xFF0000, 0xAB5500, 0xABAB00, 0x00FF00,
     0x00AB55, 0x0000FF, 0x5500AB, 0xAB0055
 };
-AlaPalette alaPalRainbow = { 8, alaPalRainbow_ };
+constexpr AlaPaletteLut alaPalRainbow__ = alaMakePaletteLut(alaPalRainbow_);
+AlaPalette alaPalRainbow = { 8, alaPalRainbow_, alaPalRainbow__.colors };
 
 // Rainbow colors with alternating stripes of black
-AlaColor alaPalRainbowStripe_[] =
+constexpr AlaColor alaPalRainbowStripe_[] =
 {
     0xFF0000, 0x000000, 0xAB5500, 0x000000, 0xABAB00, 0x000000, 0x00FF00, 0x000000,
     0x00AB55, 0x000000, 0x0000FF, 0x000000, 0x5500AB, 0x000000, 0xAB0055, 0x000000
 };
-AlaPalette alaPalRainbowStripe = { 16, alaPalRainbowStripe_ };
+constexpr AlaPaletteLut alaPalRainbowStripe__ = alaMakePaletteLut(alaPalRainbowStripe_);
+AlaPalette alaPalRainbowStripe = { 16, alaPalRainbowStripe_, alaPalRainbowStripe__.colors };
 
 
 // Blue purple ping red orange yellow (and back)
 // Basically, everything but the greens.
 // This palette is good for lighting at a club or party.
-AlaColor alaPalParty_[] =
+constexpr AlaColor alaPalParty_[] =
 {
     0x5500AB, 0x84007C, 0xB5004B, 0xE5001B,
     0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
     0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E,
     0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9
 };
-AlaPalette alaPalParty = { 16, alaPalParty_ };
+constexpr AlaPaletteLut alaPalParty__ = alaMakePaletteLut(alaPalParty_);
+AlaPalette alaPalParty = { 16, alaPalParty_, alaPalParty__.colors };
 
 
 // Approximate "black body radiation" palette, akin to
@@ -62,29 +68,182 @@ AlaPalette alaPalParty = { 16, alaPalParty_ };
 // the usual 0-255, as the last 15 colors will be
 // 'wrapping around' from the hot end to the cold end,
 // which looks wrong.
-AlaColor alaPalHeat_[] =
+constexpr AlaColor alaPalHeat_[] =
 {
     0x000000, 0xFF0000, 0xFFFF00, 0xFFFFCC
 };
-AlaPalette alaPalHeat = { 4, alaPalHeat_ };
+constexpr AlaPaletteLut alaPalHeat__ = alaMakePaletteLut(alaPalHeat_);
+constexpr AlaPaletteLut alaPalHeatHeat__ = alaMakeHeatLut(alaPalHeat_);
+AlaPalette alaPalHeat = { 4, alaPalHeat_, alaPalHeat__.colors, alaPalHeatHeat__.colors };
 
 
-AlaColor alaPalFire_[] =
+constexpr AlaColor alaPalFire_[] =
 {
     0x000000, 0x220000,
     0x880000, 0xFF0000,
     0xFF6600, 0xFFCC00
 };
-AlaPalette alaPalFire = { 6, alaPalFire_ };
+constexpr AlaPaletteLut alaPalFire__ = alaMakePaletteLut(alaPalFire_);
+constexpr AlaPaletteLut alaPalFireHeat__ = alaMakeHeatLut(alaPalFire_);
+AlaPalette alaPalFire = { 6, alaPalFire_, alaPalFire__.colors, alaPalFireHeat__.colors };
 
-AlaColor alaPalCool_[] =
+constexpr AlaColor alaPalCool_[] =
 {
     0x0000FF,
     0x0099DD, 0x444488, 0x9900DD
 };
-AlaPalette alaPalCool = { 4, alaPalCool_ };
+constexpr AlaPaletteLut alaPalCool__ = alaMakePaletteLut(alaPalCool_);
+constexpr AlaPaletteLut alaPalCoolHeat__ = alaMakeHeatLut(alaPalCool_);
+AlaPalette alaPalCool = { 4, alaPalCool_, alaPalCool__.colors, alaPalCoolHeat__.colors };
+
+
+
+
+/* Curves for alaWave().  To regenerate, run this in Python:
+import math
+curves = {
+ 'Linear':    lambda x: x,
+ 'Sine':      lambda x: (1-math.cos(math.pi*x))/2,
+ 'EaseIn':    lambda x: x**3,
+ 'EaseOut':   lambda x: 1-(1-x)**3,
+ 'EaseInOut': lambda x: 4*x**3 if x<0.5 else 1-(-2*x+2)**3/2,
+ 'Exp':       lambda x: (2**(8*x)-1)/255,
+}
+for n,f in curves.items():
+    v=[int(f(i/256)*256+0.5) for i in range(257)]
+    print(n); print(",".join("%3d"%x for x in v))
+*/
+static const uint16_t alaWaveLinear[ALA_WAVE_STEPS+1] = {
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+   16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+   32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+   48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+   64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+   80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95,
+   96, 97, 98, 99,100,101,102,103,104,105,106,107,108,109,110,111,
+  112,113,114,115,116,117,118,119,120,121,122,123,124,125,126,127,
+  128,129,130,131,132,133,134,135,136,137,138,139,140,141,142,143,
+  144,145,146,147,148,149,150,151,152,153,154,155,156,157,158,159,
+  160,161,162,163,164,165,166,167,168,169,170,171,172,173,174,175,
+  176,177,178,179,180,181,182,183,184,185,186,187,188,189,190,191,
+  192,193,194,195,196,197,198,199,200,201,202,203,204,205,206,207,
+  208,209,210,211,212,213,214,215,216,217,218,219,220,221,222,223,
+  224,225,226,227,228,229,230,231,232,233,234,235,236,237,238,239,
+  240,241,242,243,244,245,246,247,248,249,250,251,252,253,254,255,
+  256
+};
+
+static const uint16_t alaWaveSine[ALA_WAVE_STEPS+1] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  2,  2,  2,
+    2,  3,  3,  3,  4,  4,  5,  5,  6,  6,  6,  7,  7,  8,  9,  9,
+   10, 10, 11, 12, 12, 13, 14, 14, 15, 16, 17, 17, 18, 19, 20, 21,
+   22, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
+   37, 39, 40, 41, 42, 43, 44, 46, 47, 48, 49, 50, 52, 53, 54, 56,
+   57, 58, 60, 61, 62, 64, 65, 66, 68, 69, 70, 72, 73, 75, 76, 78,
+   79, 80, 82, 83, 85, 86, 88, 89, 91, 92, 94, 95, 97, 98,100,101,
+  103,105,106,108,109,111,112,114,115,117,119,120,122,123,125,126,
+  128,130,131,133,134,136,137,139,141,142,144,145,147,148,150,151,
+  153,155,156,158,159,161,162,164,165,167,168,170,171,173,174,176,
+  177,178,180,181,183,184,186,187,188,190,191,192,194,195,196,198,
+  199,200,202,203,204,206,207,208,209,210,212,213,214,215,216,217,
+  219,220,221,222,223,224,225,226,227,228,229,230,231,232,233,234,
+  234,235,236,237,238,239,239,240,241,242,242,243,244,244,245,246,
+  246,247,247,248,249,249,250,250,250,251,251,252,252,253,253,253,
+  254,254,254,254,255,255,255,255,255,256,256,256,256,256,256,256,
+  256
+};
+
+static const uint16_t alaWaveEaseIn[ALA_WAVE_STEPS+1] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  2,
+    2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,  3,  3,  3,  4,  4,
+    4,  4,  4,  5,  5,  5,  5,  5,  6,  6,  6,  6,  7,  7,  7,  8,
+    8,  8,  8,  9,  9,  9, 10, 10, 10, 11, 11, 11, 12, 12, 13, 13,
+   14, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21,
+   21, 22, 23, 23, 24, 24, 25, 26, 26, 27, 28, 28, 29, 30, 31, 31,
+   32, 33, 34, 34, 35, 36, 37, 38, 38, 39, 40, 41, 42, 43, 44, 45,
+   46, 47, 47, 48, 49, 50, 51, 53, 54, 55, 56, 57, 58, 59, 60, 61,
+   63, 64, 65, 66, 67, 69, 70, 71, 72, 74, 75, 76, 78, 79, 80, 82,
+   83, 85, 86, 88, 89, 90, 92, 94, 95, 97, 98,100,101,103,105,106,
+  108,110,111,113,115,117,118,120,122,124,126,128,130,131,133,135,
+  137,139,141,143,145,147,150,152,154,156,158,160,162,165,167,169,
+  172,174,176,178,181,183,186,188,191,193,196,198,201,203,206,208,
+  211,214,216,219,222,224,227,230,233,236,238,241,244,247,250,253,
+  256
+};
+
+static const uint16_t alaWaveEaseOut[ALA_WAVE_STEPS+1] = {
+    0,  3,  6,  9, 12, 15, 18, 20, 23, 26, 29, 32, 34, 37, 40, 42,
+   45, 48, 50, 53, 55, 58, 60, 63, 65, 68, 70, 73, 75, 78, 80, 82,
+   85, 87, 89, 91, 94, 96, 98,100,102,104,106,109,111,113,115,117,
+  119,121,123,125,126,128,130,132,134,136,138,139,141,143,145,146,
+  148,150,151,153,155,156,158,159,161,162,164,166,167,168,170,171,
+  173,174,176,177,178,180,181,182,184,185,186,187,189,190,191,192,
+  194,195,196,197,198,199,200,201,202,203,205,206,207,208,209,209,
+  210,211,212,213,214,215,216,217,218,218,219,220,221,222,222,223,
+  224,225,225,226,227,228,228,229,230,230,231,232,232,233,233,234,
+  235,235,236,236,237,237,238,238,239,239,240,240,241,241,242,242,
+  243,243,243,244,244,245,245,245,246,246,246,247,247,247,248,248,
+  248,248,249,249,249,250,250,250,250,251,251,251,251,251,252,252,
+  252,252,252,253,253,253,253,253,253,253,254,254,254,254,254,254,
+  254,254,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+  256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
+  256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
+  256
+};
+
+static const uint16_t alaWaveEaseInOut[ALA_WAVE_STEPS+1] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  2,  2,
+    2,  2,  2,  3,  3,  3,  3,  4,  4,  4,  5,  5,  5,  6,  6,  6,
+    7,  7,  8,  8,  9,  9, 10, 10, 11, 11, 12, 13, 13, 14, 15, 15,
+   16, 17, 18, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30,
+   31, 32, 34, 35, 36, 37, 39, 40, 42, 43, 44, 46, 48, 49, 51, 52,
+   54, 56, 57, 59, 61, 63, 65, 67, 69, 71, 73, 75, 77, 79, 81, 83,
+   86, 88, 90, 93, 95, 98,100,103,105,108,111,114,116,119,122,125,
+  128,131,134,137,140,142,145,148,151,153,156,158,161,163,166,168,
+  170,173,175,177,179,181,183,185,187,189,191,193,195,197,199,200,
+  202,204,205,207,208,210,212,213,214,216,217,219,220,221,222,224,
+  225,226,227,228,229,230,231,232,233,234,235,236,237,238,238,239,
+  240,241,241,242,243,243,244,245,245,246,246,247,247,248,248,249,
+  249,250,250,250,251,251,251,252,252,252,253,253,253,253,254,254,
+  254,254,254,255,255,255,255,255,255,255,255,255,256,256,256,256,
+  256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
+  256
+};
 
+static const uint16_t alaWaveExp[ALA_WAVE_STEPS+1] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+    1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  2,  2,  2,  2,  2,
+    2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,  3,  3,
+    3,  3,  3,  3,  3,  3,  4,  4,  4,  4,  4,  4,  4,  4,  4,  5,
+    5,  5,  5,  5,  5,  5,  5,  6,  6,  6,  6,  6,  6,  7,  7,  7,
+    7,  7,  7,  8,  8,  8,  8,  8,  9,  9,  9,  9,  9, 10, 10, 10,
+   10, 11, 11, 11, 11, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 15,
+   15, 15, 16, 16, 17, 17, 17, 18, 18, 19, 19, 19, 20, 20, 21, 21,
+   22, 22, 23, 23, 24, 24, 25, 25, 26, 27, 27, 28, 28, 29, 30, 30,
+   31, 32, 33, 33, 34, 35, 36, 36, 37, 38, 39, 40, 41, 42, 43, 43,
+   44, 45, 46, 47, 49, 50, 51, 52, 53, 54, 55, 57, 58, 59, 61, 62,
+   63, 65, 66, 68, 69, 71, 72, 74, 75, 77, 79, 81, 82, 84, 86, 88,
+   90, 92, 94, 96, 98,100,102,105,107,109,112,114,117,119,122,125,
+  127,130,133,136,139,142,145,149,152,155,159,162,166,169,173,177,
+  181,185,189,193,197,202,206,210,215,220,225,230,235,240,245,250,
+  256
+};
 
+const uint16_t *alaWaveTable(unsigned int wave)
+{
+    switch (wave) {
+        case ALA_WAVE_SINE:         return alaWaveSine;
+        case ALA_WAVE_EASEIN:       return alaWaveEaseIn;
+        case ALA_WAVE_EASEOUT:      return alaWaveEaseOut;
+        case ALA_WAVE_EASEINOUT:    return alaWaveEaseInOut;
+        case ALA_WAVE_EXP:          return alaWaveExp;
+        default:                    return alaWaveLinear;
+    }
+}
 
 
 int getStep(long t0, long t, int v)
@@ -103,5 +262,63 @@ float mapfloat(float x, float in_min, float in_max, float out_min, float out_max
 }
 
 
+// The particle pool: 'slots' pairs of position and velocity arrays in
+// one block, followed by a byte per slot saying whether it is taken.
+static alaq16_t *particlePool = NULL;
+static uint8_t *particleUsed = NULL;
+static int particleSlots = 0;
+
+void alaParticlePoolInit(int slots)
+{
+    if (particlePool) {
+        free(particlePool);
+        particlePool = NULL;
+        particleUsed = NULL;
+        particleSlots = 0;
+    }
+    if (slots <= 0) {
+        return;
+    }
+
+    size_t arrays = (size_t) slots * 2 * ALA_PARTICLES_PER_SLOT * sizeof(alaq16_t);
+    particlePool = (alaq16_t *) malloc(arrays + slots);
+    if (!particlePool) {
+        return;
+    }
+    particleUsed = (uint8_t *) particlePool + arrays;
+    memset(particleUsed, 0, slots);
+    particleSlots = slots;
+}
+
+bool alaParticleClaim(AlaParticles *p)
+{
+    if (p->slot >= 0) {
+        return true;
+    }
+    for (int i = 0; i < particleSlots; i++) {
+        if (!particleUsed[i]) {
+            particleUsed[i] = 1;
+            p->slot = i;
+            p->pos = particlePool + 2 * ALA_PARTICLES_PER_SLOT * i;
+            p->vel = p->pos + ALA_PARTICLES_PER_SLOT;
+            p->count = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void alaParticleRelease(AlaParticles *p)
+{
+    if ((p->slot >= 0) && (p->slot < particleSlots)) {
+        particleUsed[p->slot] = 0;
+    }
+    p->slot = -1;
+    p->count = 0;
+    p->pos = NULL;
+    p->vel = NULL;
+}
+
+
 
 
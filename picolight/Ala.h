@@ -39,6 +39,128 @@ static inline float constrain(float x, float a, float b)
     return x;
 }
 
+// The RP2040 has no FPU, so the animations work in fixed point: Q16
+// (65536 = 1.0) for positions along a strip or palette, and Q8 (256 =
+// 1.0) for brightness and blend factors.
+typedef int32_t alaq16_t;
+#define ALA_Q16_ONE 65536
+#define ALA_Q8_ONE  256
+
+// Convert a Q16 factor to Q8, limited to 0..1.
+static inline unsigned int alaClampQ8(alaq16_t k)
+{
+    if (k <= 0) return 0;
+    if (k >= ALA_Q16_ONE) return ALA_Q8_ONE;
+    return (unsigned int) k >> 8;
+}
+
+// Curves for the fading animations, chosen with the animation's option
+// (la_option).  Each one rises from 0 to 1; fading out runs it
+// backwards, and the pulsing animations (fadeInOut, glow) go up and
+// back down it, so LINEAR makes a triangle wave and SINE a sine wave.
+#define ALA_WAVE_DEFAULT    0   // Whatever the animation always used
+#define ALA_WAVE_LINEAR     1
+#define ALA_WAVE_SINE       2   // Half a cosine: gentle at both ends
+#define ALA_WAVE_EASEIN     3   // Cubic, slow to start
+#define ALA_WAVE_EASEOUT    4   // Cubic, slow to finish
+#define ALA_WAVE_EASEINOUT  5   // Cubic, slow at both ends
+#define ALA_WAVE_EXP        6   // Even steps in perceived brightness;
+                                // backwards, an exponential decay
+
+// The curves are tables of Q8 values at ALA_WAVE_STEPS even steps,
+// plus the end point.
+#define ALA_WAVE_STEPS      256
+
+// The table for 'wave' (LINEAR for any value we don't know).
+const uint16_t *alaWaveTable(unsigned int wave);
+
+// Look up Q16 position 's' (limited to 0..1) on a curve, interpolating
+// between table entries.  Returns Q8, ready for scale8().
+static inline unsigned int alaWave(const uint16_t *w, alaq16_t s)
+{
+    if (s <= 0) return w[0];
+    if (s >= ALA_Q16_ONE) return w[ALA_WAVE_STEPS];
+
+    unsigned int i = (unsigned int) s >> 8;
+    unsigned int f = s & 0xFF;
+    return w[i] + (((int) (w[i+1] - w[i]) * (int) f) >> 8);
+}
+
+// A small random number generator (xorshift32) for the animations, one
+// per strip so that strips neither share nor race on one state and the
+// same seed always gives the same sparkles.  below(n) scales instead of
+// dividing (0..n-1, n up to 65536 or so), which is near enough uniform.
+struct AlaRandom
+{
+    uint32_t state;
+
+    void seed(uint32_t s)
+    {
+        state = s ? s : 0x6D2B79F5;     // 0 would stick at 0
+    }
+
+    uint32_t next()
+    {
+        uint32_t x = state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return state = x;
+    }
+
+    uint32_t below(uint32_t n)
+    {
+        return ((uint64_t) next() * n) >> 32;
+    }
+};
+
+// Combine a seed with a strip number, so neighbouring strips get
+// unrelated sequences (the murmur3 finalizer).
+static inline uint32_t alaMixSeed(uint32_t seed, uint32_t index)
+{
+    uint32_t h = seed ^ (index * 0x9E3779B9);
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+// Particles for the particle effects (bouncing balls, bubbles), kept as
+// arrays of positions and velocities in Q16, 1.0 being the far end of
+// the strip.  The arrays come from a pool of fixed-size slots set up
+// once (alaParticlePoolInit), so changing animations never touches the
+// heap; a strip holds on to its slot for as long as it runs a particle
+// effect.
+#define ALA_PARTICLES_PER_SLOT 32
+
+struct AlaParticles
+{
+    int slot;           // Pool slot, -1 if none
+    int count;          // Particles in use, 0 until the effect starts
+    alaq16_t *pos;
+    alaq16_t *vel;
+};
+
+// (Re)create the pool with room for 'slots' strips' particles.  Any
+// slots handed out before are lost, so only call this with none in use.
+void alaParticlePoolInit(int slots);
+
+// Give 'p' a slot, if it hasn't one.  Returns false if the pool is full.
+bool alaParticleClaim(AlaParticles *p);
+
+// Hand back the slot (if any) held by 'p'.
+void alaParticleRelease(AlaParticles *p);
+
+// The pixel (0..numLeds-1) a Q16 position falls on.
+static inline int alaParticlePixel(alaq16_t pos, int numLeds)
+{
+    if (pos <= 0) return 0;
+    if (pos >= ALA_Q16_ONE) return numLeds - 1;
+    return ((int64_t) pos * (numLeds - 1)) >> 16;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Animations
 
@@ -104,35 +226,52 @@ static inline float constrain(float x, float a, float b)
 // Strobo effect duty cycle (10=1/10)
 #define ALA_STROBODC 10
 
+// Post-processing, done to every frame after the animation has drawn it
+// (see AlaLedRgb::setPostProcess).  These are also the LSCMD_POSTPROCESS
+// flags.
+#define ALA_POST_MIRROR     0x01    // Second half is the first reflected
+#define ALA_POST_REVERSE    0x02    // End for end (with MIRROR: centre out)
+#define ALA_POST_BLUR       0x04    // Blend each pixel with its neighbours
+#define ALA_POST_DECAY      0x08    // Trails: old frames fade out slowly
+
+// How much of the last frame a decaying pixel keeps (Q8): 0.88, as
+// sparkle2 has always used.
+#define ALA_DECAY_DEFAULT   225
+
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// The members are in the order a NEO_GRB strip wants them on the wire,
+// so raw[] can be sent out as it is (see Pico_NeoPixelGather).
 struct AlaColor
 {
     union
     {
         struct
         {
-            uint8_t r;
             uint8_t g;
+            uint8_t r;
             uint8_t b;
         };
         uint8_t raw[3];
     };
 
-    inline AlaColor() __attribute__((always_inline))
+    // constexpr (so palette tables can be built at compile time) means
+    // this has to initialize something; black it is.
+    inline constexpr AlaColor() __attribute__((always_inline))
+    : g(0), r(0), b(0)
     {
     }
 
     // allow construction from R, G, B
-    inline AlaColor( uint8_t ir, uint8_t ig, uint8_t ib)  __attribute__((always_inline))
-    : r(ir), g(ig), b(ib)
+    inline constexpr AlaColor( uint8_t ir, uint8_t ig, uint8_t ib)  __attribute__((always_inline))
+    : g(ig), r(ir), b(ib)
     {
     }
 
     // allow construction from 32-bit (really 24-bit) bit 0xRRGGBB color code
-    inline AlaColor( uint32_t colorcode)  __attribute__((always_inline))
-    : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b((colorcode >> 0) & 0xFF)
+    inline constexpr AlaColor( uint32_t colorcode)  __attribute__((always_inline))
+    : g((colorcode >> 8) & 0xFF), r((colorcode >> 16) & 0xFF), b((colorcode >> 0) & 0xFF)
     {
     }
 
@@ -146,7 +285,7 @@ struct AlaColor
         return AlaColor(r*maxOut.r/255, g*maxOut.g/255, b*maxOut.b/255);
     }
 */
-    AlaColor sum(AlaColor color)
+    AlaColor sum(AlaColor color) const
     {
         int r0 = min(color.r + r, 255);
         int g0 = min(color.g + g, 255);
@@ -154,7 +293,7 @@ struct AlaColor
         return AlaColor(r0, g0, b0);
     }
 
-    AlaColor interpolate(AlaColor color, float x)
+    AlaColor interpolate(AlaColor color, float x) const
     {
         int r0 = x*(color.r - r) + r;
         int g0 = x*(color.g - g) + g;
@@ -162,7 +301,7 @@ struct AlaColor
         return AlaColor(r0, g0, b0);
     }
 
-    AlaColor scale(float k)
+    AlaColor scale(float k) const
     {
         int r0 = min(r*k, 255);
         int g0 = min(g*k, 255);
@@ -170,6 +309,24 @@ struct AlaColor
         return AlaColor(r0, g0, b0);
     }
 
+    // Fixed-point interpolate(), x in Q8 (0..256).
+    constexpr AlaColor interpolate8(AlaColor color, int x) const
+    {
+        int r0 = ((x*(color.r - r)) >> 8) + r;
+        int g0 = ((x*(color.g - g)) >> 8) + g;
+        int b0 = ((x*(color.b - b)) >> 8) + b;
+        return AlaColor(r0, g0, b0);
+    }
+
+    // Fixed-point scale(), k in Q8 (256 = 1.0).
+    AlaColor scale8(unsigned int k) const
+    {
+        unsigned int r0 = min((r*k) >> 8, 255);
+        unsigned int g0 = min((g*k) >> 8, 255);
+        unsigned int b0 = min((b*k) >> 8, 255);
+        return AlaColor(r0, g0, b0);
+    }
+
 
     typedef enum {
         Aqua    = 0x00FFFF,
@@ -197,10 +354,56 @@ struct AlaColor
 // Struct definitions
 ////////////////////////////////////////////////////////////////////////////////
 
+// The built-in palettes also come as a gradient table of ALA_PAL_LUTSIZE
+// colors covering one trip around the palette, so a color is a lookup
+// rather than an interpolation.  The tables are built by the compiler
+// and live in flash.
+#define ALA_PAL_LUTBITS 8
+#define ALA_PAL_LUTSIZE (1 << ALA_PAL_LUTBITS)
+
+struct AlaPaletteLut
+{
+    AlaColor colors[ALA_PAL_LUTSIZE];
+};
+
+// Entry i is what getPalColor16() gives for position i*N/ALA_PAL_LUTSIZE.
+template <int N>
+constexpr AlaPaletteLut alaMakePaletteLut(const AlaColor (&colors)[N])
+{
+    AlaPaletteLut lut {};
+
+    for (int i = 0; i < ALA_PAL_LUTSIZE; i++) {
+        uint32_t pos = ((uint32_t) i * N) << (16 - ALA_PAL_LUTBITS);
+        int i0 = pos >> 16;
+        int i1 = (i0 + 1) % N;
+        lut.colors[i] = colors[i0].interpolate8(colors[i1], (pos >> 8) & 0xFF);
+    }
+    return lut;
+}
+
+// A heat table runs from the first color to the last over
+// ALA_PAL_LUTSIZE entries without wrapping around, for effects that map
+// an 8-bit level (like a flame's heat) onto the palette.
+template <int N>
+constexpr AlaPaletteLut alaMakeHeatLut(const AlaColor (&colors)[N])
+{
+    AlaPaletteLut lut {};
+
+    for (int i = 0; i < ALA_PAL_LUTSIZE; i++) {
+        uint32_t pos = ((uint32_t) i * (N - 1) << 16) / (ALA_PAL_LUTSIZE - 1);
+        int i0 = pos >> 16;
+        int i1 = (i0 + 1 < N) ? (i0 + 1) : i0;
+        lut.colors[i] = colors[i0].interpolate8(colors[i1], (pos >> 8) & 0xFF);
+    }
+    return lut;
+}
+
 struct AlaPalette
 {
     int numColors;
-    AlaColor *colors;
+    const AlaColor *colors;
+    const AlaColor *lut;        // ALA_PAL_LUTSIZE-entry gradient, or NULL
+    const AlaColor *heat;       // ALA_PAL_LUTSIZE-entry heat table, or NULL
 
     /**
     * Get the interpolated color from the palette.
@@ -218,6 +421,30 @@ struct AlaPalette
         return colors[i0].interpolate(colors[i1], t0);
     }
 
+    /**
+    * Fixed-point getPalColor(), i in Q16 (0 to numColors << 16).
+    */
+    AlaColor getPalColor16(alaq16_t i)
+    {
+        uint32_t u = (uint32_t) i;
+        int i0 = (u >> 16) % numColors;
+        int i1 = (i0 + 1) % numColors;
+
+        return colors[i0].interpolate8(colors[i1], (u >> 8) & 0xFF);
+    }
+
+    /**
+    * Color at 'phase' of the way around the palette, where 2^32 is
+    * one full cycle.  Uses the gradient table if there is one.
+    */
+    AlaColor getPhaseColor(uint32_t phase)
+    {
+        if (lut)
+            return lut[phase >> (32 - ALA_PAL_LUTBITS)];
+
+        return getPalColor16((phase >> 16) * numColors);
+    }
+
     bool operator == (const AlaPalette &c) const
     {
         if (!(this->numColors == c.numColors))
@@ -263,7 +490,7 @@ extern AlaPalette alaPalParty;
 
 extern AlaPalette alaPalHeat;
 
-// Fire palette to be used with ALA_FIRE effect
+// Fire palette to be used with ALA_FLAME effect (the default for it)
 extern AlaPalette alaPalFire;
 
 extern AlaPalette alaPalCool;
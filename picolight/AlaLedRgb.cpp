@@ -7,23 +7,53 @@ AlaLedRgb::AlaLedRgb()
 {
     // set default values
 
-    maxOut = 0xFFFFFF;
     speed = 1000;
     animSeqLen = 0;
     lastRefreshTime = 0;
-    refreshMillis = 1000/50;
-    pxPos = NULL;
-    pxSpeed = NULL;
+    animStartTime = 0;
+    frameTime = 0;
+    framePhase = 0;
+    phaseInc = 0;
+    refreshUs = 1000000/50;
+    particles.slot = -1;
+    particles.count = 0;
+    particles.pos = NULL;
+    particles.vel = NULL;
+    pxLastRefresh = 0;
+    rendered = false;
+    solid = false;
+    numLit = 0;
+    litValid = false;
+    litFrame = false;
+    numDirty = -1;
     numLeds = 0;
     option = 0;
     direction = 0;
+    wave = alaWaveTable(ALA_WAVE_LINEAR);
     animSeq = NULL;
     animSeqLen = 0;
     animSeqDuration = 0;
     animFunc = NULL;
+    keyFunc = NULL;
+    seed = 0;
+    rng.seed(seed);
+    frameKey = 0;
+    frameKeyValid = false;
     refreshRate = 0;
     leds = NULL;
+    frame = NULL;
+    heat = NULL;
+    postFlags = 0;
+    postDecay = ALA_DECAY_DEFAULT;
+    postBlur = ALA_Q8_ONE;
+    post = NULL;
+    postFading = false;
+    leader = NULL;
+    frameSeq = 0;
+    leaderSeq = 0;
     numSubStrips = 0;
+    numRuns = 0;
+    runsOverlap = false;
     animSeqCount = 0;
     animation = ALA_STOPSEQ;
 }
@@ -37,15 +67,17 @@ AlaLedRgb::~AlaLedRgb()
         leds = NULL;
     }
 
-    if (pxPos != NULL) {
-        delete[] pxPos;
-        pxPos = NULL;
+    if (heat) {
+        free(heat);
+        heat = NULL;
     }
 
-    if (pxSpeed != NULL) {
-        delete[] pxSpeed;
-        pxSpeed = NULL;
+    if (post) {
+        free(post);
+        post = NULL;
     }
+
+    alaParticleRelease(&particles);
 }
 
 
@@ -81,26 +113,199 @@ void AlaLedRgb::begin(void)
     }
 
     leds = ledStorage;
+    frame = leds;
 
     // save the total
     numLeds = total;
+
+    buildRuns();
 }
 
 
 
+// The limit is applied by the physical strips' output tables, so it
+// covers everything drawn on them, including by other logical strips.
 void AlaLedRgb::setBrightness(AlaColor maxOut)
 {
-    this->maxOut = maxOut;
+    for (int i = 0; i < numSubStrips; i++) {
+        subStrips[i].pixels->setMaxOut(((uint32_t) maxOut.r << 16) | ((uint32_t) maxOut.g << 8) | maxOut.b);
+    }
+}
+
+void AlaLedRgb::setPostProcess(unsigned int flags, unsigned int decay, unsigned int blur)
+{
+    postDecay = decay ? decay : ALA_DECAY_DEFAULT;
+    postBlur = blur ? blur : ALA_Q8_ONE;
+
+    if (flags && !post && leds) {
+        post = (AlaColor *)malloc(3*numLeds);
+        if (post) {
+            for (int x = 0; x < numLeds; x++)
+                post[x] = 0;
+        }
+    }
+    if (!flags || !post) {
+        if (post)
+            free(post);
+        post = NULL;
+        flags = 0;
+        postFading = false;
+    }
+
+    postFlags = flags;
+    frame = post ? post : leds;
+
+    // Redo the frame being shown, in case there are no more (a stopped
+    // animation).
+    if (post)
+        postProcess();
+    frameKeyValid = false;
+    redraw();
+}
+
+// Everything a frame depends on has to match, and the animation can't
+// use the strip's random numbers (each strip has its own) or build on
+// its last frame.
+bool AlaLedRgb::canShare(AlaLedRgb *o)
+{
+    switch (animation) {
+        case ALA_SPARKLE:
+        case ALA_SPARKLE2:
+        case ALA_FLAME:
+        case ALA_BOUNCINGBALLS:
+        case ALA_BUBBLES:
+        case ALA_STOPSEQ:
+            return false;
+    }
+
+    return (animation == o->animation) && (speed == o->speed) &&
+        (option == o->option) && (numLeds == o->numLeds) &&
+        (animStartTime == o->animStartTime) && (refreshUs == o->refreshUs) &&
+        !post && !o->post && leds && o->leds &&
+        (palette == o->palette) && (palette.lut == o->palette.lut) &&
+        (palette.heat == o->palette.heat);
+}
+
+void AlaLedRgb::setLeader(AlaLedRgb *l)
+{
+    if (l == leader)
+        return;
+
+    // Whichever way it goes, the next blit starts from scratch.
+    leader = l;
+    if (leader)
+        leaderSeq = leader->frameSeq;
+    frameKeyValid = false;
+    litValid = false;
+    redraw();
+}
+
+void AlaLedRgb::setSeed(uint32_t seed)
+{
+    this->seed = seed;
+    rng.seed(seed);
 }
 
 void AlaLedRgb::setAnimationSpeed(long newSpeed)
 {
     this->speed = newSpeed;
+    setPhaseRate();
 }
 
 void AlaLedRgb::setRefreshRate(int refreshRate)
 {
-    this->refreshMillis = 1000/refreshRate;
+    this->refreshUs = 1000000/refreshRate;
+}
+
+// The animations run in cycles of 'speed' milliseconds.  Work out how
+// much a 32-bit phase advances per microsecond so that each frame's
+// phase is a single multiply (it wraps around at the end of a cycle on
+// its own).  The extra 16 fraction bits keep the cycle length right to
+// well under a microsecond.
+void AlaLedRgb::setPhaseRate()
+{
+    if (speed > 0) {
+        phaseInc = (((uint64_t) 1) << 48) / ((uint64_t) speed * 1000);
+    } else {
+        phaseInc = 0;
+    }
+}
+
+alaq16_t AlaLedRgb::progress()
+{
+    if ((phaseInc == 0) || ((frameTime - animStartTime) >= (uint64_t) speed * 1000)) {
+        return ALA_Q16_ONE;
+    }
+    return framePhase >> 16;
+}
+
+void AlaLedRgb::clearLit()
+{
+    litFrame = true;
+
+    if (!litValid) {
+        for (int x = 0; x < numLeds; x++) {
+            leds[x] = 0;
+        }
+        numLit = 0;
+        numDirty = -1;
+        litValid = true;
+        return;
+    }
+
+    for (int i = 0; i < numLit; i++) {
+        leds[lit[i]] = 0;
+        touch(lit[i]);
+    }
+    numLit = 0;
+}
+
+// Mirror, reverse, blur and decay the frame in leds[] into post[], in
+// one pass.  Output pixel x comes from pixel s of leds[]; the blur is
+// done around s, which comes to the same since neighbours stay
+// neighbours.
+void AlaLedRgb::postProcess()
+{
+    bool mirror = (postFlags & ALA_POST_MIRROR) != 0;
+    int len = mirror ? (numLeds+1)/2 : numLeds;
+
+    // A uniform frame isn't in leds[] yet.
+    if (solid) {
+        for (int x = 0; x < numLeds; x++)
+            leds[x] = solidColor;
+        solid = false;
+    }
+
+    postFading = false;
+    for (int x = 0; x < numLeds; x++) {
+        int s = x;
+        if (mirror && (s >= len))
+            s = numLeds-1-s;
+        if (postFlags & ALA_POST_REVERSE)
+            s = len-1-s;
+
+        AlaColor c = leds[s];
+        if (postFlags & ALA_POST_BLUR) {
+            AlaColor l = leds[(s > 0) ? s-1 : s];
+            AlaColor r = leds[(s < len-1) ? s+1 : s];
+            // x171>>9 is /3
+            AlaColor avg = AlaColor(((l.r + c.r + r.r) * 171) >> 9,
+                                    ((l.g + c.g + r.g) * 171) >> 9,
+                                    ((l.b + c.b + r.b) * 171) >> 9);
+            c = c.interpolate8(avg, postBlur);
+        }
+        if (postFlags & ALA_POST_DECAY) {
+            // The brighter of the new pixel and the old one faded
+            AlaColor o = post[x].scale8(postDecay);
+            if ((o.r > c.r) || (o.g > c.g) || (o.b > c.b))
+                postFading = true;
+            c = AlaColor(max(c.r, o.r), max(c.g, o.g), max(c.b, o.b));
+        }
+        post[x] = c;
+    }
+
+    // It all changes, whatever the animation touched.
+    numDirty = -1;
 }
 
 int AlaLedRgb::getCurrentRefreshRate()
@@ -112,26 +317,62 @@ int AlaLedRgb::getCurrentRefreshRate()
 
 void AlaLedRgb::forceAnimation(int animation, long speed, unsigned int direction, unsigned int option, AlaPalette palette, AlaColor color)
 {
-    // delete any previously allocated array
-    if (pxPos!=NULL)
-    { delete[] pxPos; pxPos=NULL; }
-    if (pxSpeed!=NULL)
-    { delete[] pxSpeed; pxSpeed=NULL; }
+    // Particle effects keep their slot (and start over); anything else
+    // gives it back.
+    if ((animation == ALA_BOUNCINGBALLS) || (animation == ALA_BUBBLES)) {
+        alaParticleClaim(&particles);
+        particles.count = 0;
+    } else {
+        alaParticleRelease(&particles);
+    }
+
+    // A uniform-color animation leaves leds[] alone (see fill()), but
+    // the next one may build on what is there (sparkle2 does).
+    if (solid) {
+        for (int i = 0; i < numLeds; i++) {
+            leds[i] = solidColor;
+        }
+        solid = false;
+    }
+    litValid = false;
 
     this->animation = animation;
     this->speed = speed;
     this->option = option;
     this->palette = palette;
     this->direction = direction;
+    buildRuns();
 
     if (this->palette.numColors == 0) {
         this->singleColor = color;
         this->palette.colors = &(this->singleColor);
         this->palette.numColors = 1;
+        this->palette.lut = NULL;
+        this->palette.heat = NULL;
+    }
+
+    // A flame starts out cold.  Its byte per pixel is only taken the
+    // first time the strip runs one, and kept from then on.
+    if (animation == ALA_FLAME) {
+        if (!heat)
+            heat = (uint8_t *)malloc(numLeds);
+        if (heat)
+            memset(heat, 0, numLeds);
     }
 
     setAnimationFunc(animation);
-    animStartTime = MILLIS();
+    frameKeyValid = false;
+
+    // Only the fading animations look at the curve, but it costs nothing
+    // to pick it here rather than every frame.
+    if (option != ALA_WAVE_DEFAULT) {
+        wave = alaWaveTable(option);
+    } else {
+        wave = alaWaveTable((animation == ALA_GLOW) ? ALA_WAVE_SINE : ALA_WAVE_LINEAR);
+    }
+    rng.seed(seed);     // Same seed, same effect, on every controller
+    setPhaseRate();
+    animStartTime = time_us_64();
     animSeqCount = 0;
 }
 
@@ -150,67 +391,261 @@ int AlaLedRgb::getAnimation()
     return animation;
 }
 
-bool AlaLedRgb::findPixel(int idx, Pico_NeoPixel **strip, int *whichLed)
+// Work out where each substrip's share of leds[] goes.  Logical pixel j
+// (counting along the substrips) comes from leds[j], or from
+// leds[numLeds-1-j] when the animation runs backwards.
+void AlaLedRgb::buildRuns(void)
 {
-    int i;
+    int offset = 0;
+
+    numRuns = 0;
+    for (int i = 0; i < numSubStrips; i++) {
+        AlaSubStrip *ss = &subStrips[i];
+        AlaRun *run = &runs[numRuns];
 
-    for (i = 0; i < numSubStrips; i++) {
-        if (idx < subStrips[i].numLeds) {
-            *whichLed = (subStrips[i].reverse ? ((subStrips[i].numLeds-1) - idx) : idx) +
-                subStrips[i].startingLed;
-            *strip = subStrips[i].pixels;
-            return true;
+        if (ss->numLeds == 0) {
+            continue;
+        }
+
+        run->strip = ss->pixels;
+        run->count = ss->numLeds;
+        if (!direction) {
+            // leds[offset] is the substrip's first logical pixel
+            run->src = offset;
+            run->first = ss->reverse ? (ss->startingLed + ss->numLeds - 1) : ss->startingLed;
+            run->step = ss->reverse ? -1 : 1;
+        } else {
+            // leds[src] is the substrip's last logical pixel
+            run->src = numLeds - offset - ss->numLeds;
+            run->first = ss->reverse ? ss->startingLed : (ss->startingLed + ss->numLeds - 1);
+            run->step = ss->reverse ? 1 : -1;
+        }
+        numRuns++;
+        offset += ss->numLeds;
+    }
+
+    // Where substrips overlap, the one written last wins.  Running
+    // backwards, that is the first substrip, so keep the runs in
+    // leds[] order.
+    if (direction) {
+        for (int i = 0; i < numRuns/2; i++) {
+            AlaRun t = runs[i];
+            runs[i] = runs[numRuns-1-i];
+            runs[numRuns-1-i] = t;
+        }
+    }
+
+    // Copying single pixels would let an earlier run win, so blit() has
+    // to copy everything if any two runs overlap.
+    runsOverlap = false;
+    for (int i = 0; i < numRuns; i++) {
+        for (int j = i+1; j < numRuns; j++) {
+            int lo1 = (runs[i].step > 0) ? runs[i].first : runs[i].first - runs[i].count + 1;
+            int lo2 = (runs[j].step > 0) ? runs[j].first : runs[j].first - runs[j].count + 1;
+            if ((runs[i].strip == runs[j].strip) &&
+                (lo1 < lo2 + runs[j].count) && (lo2 < lo1 + runs[i].count)) {
+                runsOverlap = true;
+            }
         }
-        idx = idx - subStrips[i].numLeds;
     }
-    return false;
 }
 
 
 bool AlaLedRgb::runAnimation()
 {
-    if(animation == ALA_STOPSEQ)
+    return runAnimation(time_us_64());
+}
+
+bool AlaLedRgb::runAnimation(uint64_t now)
+{
+    if((animation == ALA_STOPSEQ) && !postFading)
         return true;
+
+    if (!render(now)) {
+        blit();     // In case of a redraw()
+        return false;
+    }
+
+    blit();
+    return true;
+}
+
+
+bool AlaLedRgb::render(uint64_t now)
+{
+    if((animation == ALA_STOPSEQ && !postFading) || numLeds == 0 || leader)
+        return false;
     
     // skip the refresh if not enough time has passed since last update
-    unsigned long cTime = MILLIS();
-    if (cTime < lastRefreshTime + refreshMillis)
+    if (now < lastRefreshTime + refreshUs)
         return false;
 
     // calculate real refresh rate
-    refreshRate = 1000/(cTime - lastRefreshTime);
+    refreshRate = 1000000/(now - lastRefreshTime);
+
+    lastRefreshTime = now;
 
-    lastRefreshTime = cTime;
+    // Everything the animation needs to know about time, worked out
+    // once for the frame.
+    frameTime = now;
+    framePhase = (uint32_t) (((now - animStartTime) * phaseInc) >> 16);
 
+    // A stopped animation draws nothing new, but its trail still has
+    // to fade out to the frame it stopped on.
+    if (animation == ALA_STOPSEQ) {
+        postProcess();
+        frameSeq++;
+        rendered = true;
+        return true;
+    }
 
-    // run the animantion calculation
+    // The step-driven animations only change a few times a second; until
+    // then leds[] (or solidColor) already holds this frame.
+    // (Not with trails, which keep changing.)
+    if ((keyFunc != NULL) && !(postFlags & ALA_POST_DECAY)) {
+        uint64_t key = (this->*keyFunc)();
+        if (frameKeyValid && (key == frameKey))
+            return false;
+        frameKey = key;
+        frameKeyValid = true;
+    }
+
+    // run the animantion calculation.  If the last frame hasn't been
+    // blitted yet, what it changed still has to be.
+    solid = false;
+    litFrame = false;
+    if (!rendered)
+        numDirty = 0;
     if (animFunc != NULL)
         (this->*animFunc)();
+    if (!litFrame) {
+        litValid = false;
+        numDirty = -1;
+    }
+    if (post)
+        postProcess();
 
-    {
-        // this is not really so smart...
-        for(int i=0; i<numLeds; i++) {
-            Pico_NeoPixel *strip;
-            int whichLed;
-            // If the direction is backwards, reverse the order that we fill in the pixels
-            int ledidx = direction ? (numLeds-1-i) : i;
-
-            if (findPixel(ledidx, &strip, &whichLed) == true) {
-                strip->setPixelColor(whichLed, strip->Color((leds[i].r*maxOut.r)>>8, (leds[i].g*maxOut.g)>>8, (leds[i].b*maxOut.b)>>8));
-            }
+    // keep track of how many times we have run the animation function
+    animSeqCount++;
+    frameSeq++;
+
+    rendered = true;
+    return true;
+}
+
+
+bool AlaLedRgb::blit()
+{
+    AlaLedRgb *src = this;      // Whose frame we copy
+    int nd;
+
+    if (leader) {
+        // Nothing new from the leader, and no redraw() of our own.  If we
+        // missed one of its frames, its dirty list doesn't cover them.
+        if (!rendered && (leader->frameSeq == leaderSeq))
+            return false;
+        src = leader;
+        nd = (rendered || (leader->frameSeq != leaderSeq + 1)) ? -1 : leader->numDirty;
+        leaderSeq = leader->frameSeq;
+    } else {
+        if (!rendered)
+            return false;
+        nd = numDirty;
+    }
+    rendered = false;
+
+    // One color all over: fill each substrip's span in one go.  A strip
+    // sent straight from leds[] needs them filled in after all.
+    if (src->solid) {
+        AlaColor c = src->solidColor;
+        bool gathered = false;
+        for (int i = 0; i < numSubStrips; i++) {
+            Pico_NeoPixel *strip = subStrips[i].pixels;
+            if (subStrips[i].numLeds == 0)
+                continue;
+            strip->fill(strip->Color(c.r, c.g, c.b), subStrips[i].startingLed, subStrips[i].numLeds);
+            gathered |= strip->isGathered();
         }
+        if (gathered) {
+            for (int x = 0; x < numLeds; x++)
+                src->leds[x] = c;
+            src->solid = false;
+        }
+        return true;
+    }
 
-        // We do not update the strips here anymore.
-        //  neopixels->show();
+    // Only a few pixels changed: copy just those, through every run
+    // they fall in.
+    const AlaColor *f = src->frame;
+    if ((nd >= 0) && !runsOverlap) {
+        for (int d = 0; d < nd; d++) {
+            int x = src->dirty[d];
+            for (int i = 0; i < numRuns; i++) {
+                AlaRun *run = &runs[i];
+                int o = x - run->src;
+                if ((o >= 0) && (o < run->count))
+                    run->strip->setPixelRun(run->first + run->step*o, run->step, 1, f[x].raw);
+            }
+        }
+        return true;
     }
 
-    // keep track of how many times we have run the animation function
-    animSeqCount++;
+    for (int i = 0; i < numRuns; i++) {
+        AlaRun *run = &runs[i];
+        run->strip->setPixelRun(run->first, run->step, run->count, f[run->src].raw);
+    }
 
+    // We do not update the strips here anymore.
+    //  neopixels->show();
     return true;
 }
 
 
+int AlaLedRgb::getRenderCost()
+{
+    int weight;
+
+    if ((animation == ALA_STOPSEQ) && !postFading)
+        return 0;
+
+    // Following another strip, all we do is blit.
+    if (leader)
+        return numLeds;
+
+    // Relative per-pixel cost of each kernel, roughly by how much
+    // arithmetic and palette interpolation it does.
+    switch (animation) {
+        case ALA_PLASMA:                weight = 8; break;
+        case ALA_COMETCOL:
+        case ALA_PIXELSFADECOLORS:      weight = 6; break;
+        case ALA_LARSONSCANNER2:
+        case ALA_MOVINGGRADIENT:
+        case ALA_MOVINGBARS:
+        case ALA_PIXELSMOOTHSHIFTRIGHT:
+        case ALA_PIXELSMOOTHSHIFTLEFT:
+        case ALA_PIXELSMOOTHBOUNCE:     weight = 4; break;
+        case ALA_COMET:
+        case ALA_LARSONSCANNER:
+        case ALA_GLOW:
+        case ALA_FADEIN:
+        case ALA_FADEOUT:
+        case ALA_FADEINOUT:
+        case ALA_FADECOLORS:
+        case ALA_FADECOLORSLOOP:
+        case ALA_SPARKLE:
+        case ALA_SPARKLE2:
+        case ALA_FLAME:
+        case ALA_BOUNCINGBALLS:
+        case ALA_BUBBLES:               weight = 2; break;
+        default:                        weight = 1; break;
+    }
+
+    // The blit to the physical strips is paid for whatever the animation,
+    // as is post-processing.
+    return numLeds * (weight + 1 + (post ? 2 : 0));
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void AlaLedRgb::setAnimationFunc(int animation)
@@ -256,6 +691,7 @@ void AlaLedRgb::setAnimationFunc(int animation)
         case ALA_GLOW:                  animFunc = &AlaLedRgb::glow;                  break;
         case ALA_PLASMA:                animFunc = &AlaLedRgb::plasma;                break;
         case ALA_PIXELSFADECOLORS:      animFunc = &AlaLedRgb::pixelsFadeColors;      break;
+        case ALA_FLAME:                 animFunc = &AlaLedRgb::flame;                 break;
         case ALA_FADECOLORS:            animFunc = &AlaLedRgb::fadeColors;            break;
         case ALA_FADECOLORSLOOP:        animFunc = &AlaLedRgb::fadeColorsLoop;        break;
 
@@ -265,6 +701,74 @@ void AlaLedRgb::setAnimationFunc(int animation)
         default:                        animFunc = &AlaLedRgb::off;
     }
 
+    // Animations whose frame is a function of a small key (mostly a
+    // getStep()-style step count), so render() can tell when there is
+    // nothing new to draw.
+    switch(animation)
+    {
+        case ALA_ON:                    keyFunc = &AlaLedRgb::constKey;               break;
+        case ALA_BLINK:                 keyFunc = &AlaLedRgb::blinkKey;               break;
+        case ALA_BLINKALT:              keyFunc = &AlaLedRgb::blinkKey;               break;
+        case ALA_STROBO:                keyFunc = &AlaLedRgb::stroboKey;              break;
+        case ALA_CYCLECOLORS:           keyFunc = &AlaLedRgb::cycleColorsKey;         break;
+        case ALA_MOVINGBARS:            keyFunc = &AlaLedRgb::movingBarsKey;          break;
+        case ALA_PIXELSHIFTRIGHT:       keyFunc = &AlaLedRgb::pixelShiftKey;          break;
+        case ALA_PIXELSHIFTLEFT:        keyFunc = &AlaLedRgb::pixelShiftKey;          break;
+        case ALA_PIXELBOUNCE:           keyFunc = &AlaLedRgb::pixelBounceKey;         break;
+        case ALA_GROW:                  keyFunc = &AlaLedRgb::progressKey;            break;
+        case ALA_SHRINK:                keyFunc = &AlaLedRgb::progressKey;            break;
+        case ALA_PIXELMARCH:            keyFunc = &AlaLedRgb::progressKey;            break;
+        default:                        keyFunc = NULL;
+    }
+
+}
+
+static inline uint64_t colorKey(AlaColor c)
+{
+    return ((uint32_t) c.r << 16) | ((uint32_t) c.g << 8) | c.b;
+}
+
+uint64_t AlaLedRgb::constKey()
+{
+    return 0;
+}
+
+uint64_t AlaLedRgb::blinkKey()
+{
+    return stepOf(2);
+}
+
+uint64_t AlaLedRgb::stroboKey()
+{
+    return stepOf(ALA_STROBODC) == 0;
+}
+
+uint64_t AlaLedRgb::cycleColorsKey()
+{
+    return stepOf(palette.numColors);
+}
+
+uint64_t AlaLedRgb::movingBarsKey()
+{
+    return stepOf(numLeds);
+}
+
+// The lit pixel moves by steps, but its color follows the palette
+// smoothly, so that is part of the key too.
+uint64_t AlaLedRgb::pixelShiftKey()
+{
+    return ((uint64_t) stepOf(numLeds) << 24) | colorKey(palette.getPhaseColor(framePhase));
+}
+
+uint64_t AlaLedRgb::pixelBounceKey()
+{
+    return ((uint64_t) stepOf(2*numLeds-2) << 24) | colorKey(palette.getPhaseColor(framePhase));
+}
+
+// grow, shrink and pixelMarch: how many pixels in we are.
+uint64_t AlaLedRgb::progressKey()
+{
+    return (progress() * numLeds) >> 16;
 }
 
 
@@ -275,19 +779,13 @@ void AlaLedRgb::stop()
 
 void AlaLedRgb::on()
 {
-    for(int i=0; i<numLeds; i++)
-    {
-        leds[i] = palette.colors[0];
-    }
+    fill(palette.colors[0]);
 //    animation = ALA_STOPSEQ;
 }
 
 void AlaLedRgb::off()
 {
-    for(int i=0; i<numLeds; i++)
-    {
-        leds[i] = 0x000000;
-    }
+    fill(0x000000);
 
     // Have us stop.
     animation = ALA_STOPSEQ;
@@ -296,22 +794,20 @@ void AlaLedRgb::off()
 
 void AlaLedRgb::blink()
 {
-    int t = getStep(animStartTime, speed, 2);
+    int t = stepOf(2);
     int k = (t+1)%2;
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = palette.colors[0].scale(k);
-    }
+    AlaColor c = palette.colors[0].scale8(k*ALA_Q8_ONE);
+    fill(c);
 }
 
 void AlaLedRgb::blinkAlt()
 {
-    int t = getStep(animStartTime, speed, 2);
+    int t = stepOf(2);
 
     for(int x=0; x<numLeds; x++)
     {
         int k = (t+x)%2;
-        leds[x] = palette.colors[0].scale(k);
+        leds[x] = palette.colors[0].scale8(k*ALA_Q8_ONE);
     }
 }
 
@@ -320,7 +816,7 @@ void AlaLedRgb::sparkle()
     int p = speed/100;
     for(int x=0; x<numLeds; x++)
     {
-        leds[x] = palette.colors[RANDOM(palette.numColors)].scale(RANDOM(p)==0);
+        leds[x] = palette.colors[rng.below(palette.numColors)].scale8((rng.below(p)==0)*ALA_Q8_ONE);
     }
 }
 
@@ -329,23 +825,20 @@ void AlaLedRgb::sparkle2()
     int p = speed/10;
     for(int x=0; x<numLeds; x++)
     {
-        if(RANDOM(p)==0)
-            leds[x] = palette.colors[RANDOM(palette.numColors)];
+        if(rng.below(p)==0)
+            leds[x] = palette.colors[rng.below(palette.numColors)];
         else
-            leds[x] = leds[x].scale(0.88);
+            leds[x] = leds[x].scale8(ALA_DECAY_DEFAULT);
     }
 }
 
 
 void AlaLedRgb::strobo()
 {
-    int t = getStep(animStartTime, speed, ALA_STROBODC);
+    int t = stepOf(ALA_STROBODC);
 
-    AlaColor c = palette.colors[0].scale(t==0);
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    AlaColor c = palette.colors[0].scale8((t==0)*ALA_Q8_ONE);
+    fill(c);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -354,137 +847,137 @@ void AlaLedRgb::strobo()
 
 void AlaLedRgb::pixelShiftRight()
 {
-    int t = getStep(animStartTime, speed, numLeds);
-    float tx = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(tx);
+    int t = stepOf(numLeds);
+    AlaColor c = palette.getPhaseColor(framePhase);
 
-    for(int x=0; x<numLeds; x++)
-    {
-        int k = (x==t ? 1:0);
-        leds[x] = c.scale(k);
-    }
+    clearLit();
+    light(t, c);
 }
 
 void AlaLedRgb::pixelShiftLeft()
 {
-    int t = getStep(animStartTime, speed, numLeds);
-    float tx = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(tx);
+    int t = stepOf(numLeds);
+    AlaColor c = palette.getPhaseColor(framePhase);
 
-    for(int x=0; x<numLeds; x++)
-    {
-        int k = ((x==(numLeds-1-t) ? 1:0));
-        leds[x] = c.scale(k);
-    }
+    clearLit();
+    light(numLeds-1-t, c);
 }
 
 // Bounce back and forth
 void AlaLedRgb::pixelBounce()
 {
-    int t = getStep(animStartTime, speed, 2*numLeds-2);
-    float tx = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(tx);
+    int t = stepOf(2*numLeds-2);
+    AlaColor c = palette.getPhaseColor(framePhase);
 
-    for(int x=0; x<numLeds; x++)
+    clearLit();
+    light(-abs(t-numLeds+1)+numLeds-1, c);
+}
+
+// Light the (at most two) pixels within one pixel of Q16 position 'h',
+// fading with the distance.
+void AlaLedRgb::lightSmooth(alaq16_t h, AlaColor c)
+{
+    clearLit();
+    for(int x=(h>>16); x<=(h>>16)+1; x++)
     {
-        int k = x==(-abs(t-numLeds+1)+numLeds-1) ? 1:0;
-        leds[x] = c.scale(k);
+        alaq16_t k = -abs(h-(x<<16))+ALA_Q16_ONE;
+        if ((x >= 0) && (x < numLeds) && (k > 0))
+            light(x, c.scale8(alaClampQ8(k)));
     }
 }
 
 void AlaLedRgb::pixelSmoothShiftRight()
 {
-    float t = getStepFloat(animStartTime, speed, numLeds+1);
-    float tx = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(tx);
+    alaq16_t t = phaseOf(numLeds+1);
+    AlaColor c = palette.getPhaseColor(framePhase);
 
-    for(int x=0; x<numLeds; x++)
-    {
-        float k = max(0, (-abs(t-1-x)+1));
-        leds[x] = c.scale(k);
-    }
+    lightSmooth(t-ALA_Q16_ONE, c);
 }
 
 void AlaLedRgb::pixelSmoothShiftLeft()
 {
-    float t = getStepFloat(animStartTime, speed, numLeds+1);
-    float tx = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(tx);
+    alaq16_t t = phaseOf(numLeds+1);
+    AlaColor c = palette.getPhaseColor(framePhase);
 
-    for(int x=0; x<numLeds; x++)
-    {
-        float k = max(0, (-abs(numLeds-t-x)+1));
-        leds[x] = c.scale(k);
-    }
+    lightSmooth((numLeds<<16)-t, c);
+}
+
+// Brightness of the comet tail 'd' pixels (Q16, negative = behind the
+// head) from the head, for a tail 'l' pixels long:
+// constrain((d/l + 1.2) * (d < 0), 0, 1), in Q8.
+static inline unsigned int cometTail(alaq16_t d, int l)
+{
+    if ((d >= 0) || (l == 0)) return 0;
+    return alaClampQ8(d/l + 78643);            // 1.2
 }
 
 void AlaLedRgb::comet()
 {
-    float l = numLeds/2;  // length of the tail
-    float t = getStepFloat(animStartTime, speed, 2*numLeds-l);
-    float tx = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(tx);
+    int l = numLeds/2;  // length of the tail
+    alaq16_t t = phaseOf(2*numLeds-l);
+    AlaColor c = palette.getPhaseColor(framePhase);
 
     for(int x=0; x<numLeds; x++)
     {
-        float k = constrain( (((x-t)/l+1.2f))*(((x-t)<0)? 1:0), 0, 1);
-        leds[x] = c.scale(k);
+        leds[x] = c.scale8(cometTail((x<<16)-t, l));
     }
 }
 
 void AlaLedRgb::cometCol()
 {
-    float l = numLeds/2;  // length of the tail
-    float t = getStepFloat(animStartTime, speed, 2*numLeds-l);
+    int l = numLeds/2;  // length of the tail
+    alaq16_t t = phaseOf(2*numLeds-l);
+
+    // Palette cycles per pixel behind the head: (numColors-1) colors
+    // over numLeds/1.7 pixels, with 2^32 as one cycle.
+    uint32_t m = (((uint64_t) (palette.numColors-1) * 17) << 32) / (10 * numLeds * palette.numColors);
 
     AlaColor c;
     for(int x=0; x<numLeds; x++)
     {
-        float tx = mapfloat(max(t-x, 0), 0, numLeds/1.7, 0, palette.numColors-1);
-        c = palette.getPalColor(tx);
-        float k = constrain( (((x-t)/l+1.2f))*(((x-t)<0)? 1:0), 0, 1);
-        leds[x] = c.scale(k);
+        alaq16_t d = (x<<16)-t;
+        uint32_t tx = (d < 0) ? (uint32_t) (((uint64_t) -d * m) >> 16) : 0;
+        c = palette.getPhaseColor(tx);
+        leds[x] = c.scale8(cometTail(d, l));
     }
 }
 
 void AlaLedRgb::pixelSmoothBounce()
 {
     // see larsonScanner
-    float t = getStepFloat(animStartTime, speed, 2*numLeds-2);
-    AlaColor c = palette.getPalColor(getStepFloat(animStartTime, speed, palette.numColors));
+    alaq16_t t = phaseOf(2*numLeds-2);
+    AlaColor c = palette.getPhaseColor(framePhase);
+    alaq16_t h = abs(t-((numLeds-1)<<16));
 
-    for(int x=0; x<numLeds; x++)
-    {
-        float k = constrain((-abs(abs(t-numLeds+1)-x)+1), 0, 1);
-        leds[x] = c.scale(k);
-    }
+    lightSmooth(h, c);
 }
 
 
 void AlaLedRgb::larsonScanner()
 {
-    float l = numLeds/4;
-    float t = getStepFloat(animStartTime, speed, 2*numLeds-2);
-    AlaColor c = palette.getPalColor(getStepFloat(animStartTime, speed, palette.numColors));
+    int l = numLeds/4;
+    alaq16_t t = phaseOf(2*numLeds-2);
+    AlaColor c = palette.getPhaseColor(framePhase);
+    alaq16_t h = abs(t-((numLeds-1)<<16));
 
     for(int x=0; x<numLeds; x++)
     {
-        float k = constrain((-abs(abs(t-numLeds+1)-x)+l), 0, 1);
-        leds[x] = c.scale(k);
+        alaq16_t k = -abs(h-(x<<16))+(l<<16);
+        leds[x] = c.scale8(alaClampQ8(k));
     }
 }
 
 void AlaLedRgb::larsonScanner2()
 {
-    float l = numLeds/4;  // 2>7, 3-11, 4-14
-    float t = getStepFloat(animStartTime, speed, 2*numLeds+(l*4-1));
-    AlaColor c = palette.getPalColor(getStepFloat(animStartTime, speed, palette.numColors));
+    int l = numLeds/4;  // 2>7, 3-11, 4-14
+    alaq16_t t = phaseOf(2*numLeds+(l*4-1));
+    AlaColor c = palette.getPhaseColor(framePhase);
+    alaq16_t h = abs(t-((numLeds+2*l)<<16));
 
     for(int x=0; x<numLeds; x++)
     {
-
-        float k = constrain((-abs(abs(t-numLeds-2*l)-x-l)+l), 0, 1);
-        leds[x] = c.scale(k);
+        alaq16_t k = -abs(h-((x+l)<<16))+(l<<16);
+        leds[x] = c.scale8(alaClampQ8(k));
     }
 }
 
@@ -493,129 +986,157 @@ void AlaLedRgb::larsonScanner2()
 // Fading effects
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+// These all follow 'wave' (see forceAnimation()): linear by default,
+// and a sine wave for glow().
+
 void AlaLedRgb::fadeIn()
 {
-    float s = getStepFloat(animStartTime, speed, 1);
-    AlaColor c = palette.colors[0].scale(s);
+    alaq16_t s = phaseOf(1);
+    AlaColor c = palette.colors[0].scale8(alaWave(wave, s));
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    fill(c);
 }
 
 
 void AlaLedRgb::fadeOut()
 {
-    float s = getStepFloat(animStartTime, speed, 1);
-    AlaColor c = palette.colors[0].scale(1-s);
+    alaq16_t s = phaseOf(1);
+    AlaColor c = palette.colors[0].scale8(alaWave(wave, ALA_Q16_ONE-s));
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    fill(c);
 }
 
 
 void AlaLedRgb::fadeInOut()
 {
-    float s = getStepFloat(animStartTime, speed, 2) - 1;
-    AlaColor c = palette.colors[0].scale(abs(1-abs(s)));
+    alaq16_t s = phaseOf(2) - ALA_Q16_ONE;
+    AlaColor c = palette.colors[0].scale8(alaWave(wave, ALA_Q16_ONE-abs(s)));
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    fill(c);
 }
 
+// Same as fadeInOut(), but with a sine wave unless told otherwise.
 void AlaLedRgb::glow()
 {
-    float s = getStepFloat(animStartTime, speed, TWO_PI);
-    float k = (-cos(s)+1)/2;
-
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = palette.colors[0].scale(k);
-    }
+    fadeInOut();
 }
 
 void AlaLedRgb::plasma()
 {
-    float t = getStepFloat(animStartTime, speed, numLeds);
+    // Both palette positions advance by a fixed amount per pixel, so
+    // step them rather than dividing for every pixel.  2^32 is one trip
+    // around the palette, which takes numLeds pixels.
+    uint32_t d = (uint32_t) ((((uint64_t) 1) << 32) / numLeds);
+    uint32_t p1 = framePhase;
+    uint32_t p2 = -framePhase;
 
     for(int x=0; x<numLeds; x++)
     {
-        AlaColor c1 = palette.getPalColor((float)((x+t)*palette.numColors)/numLeds);
-        AlaColor c2 = palette.getPalColor((float)((2*x-t+numLeds)*palette.numColors)/numLeds);
-        leds[x] = c1.interpolate(c2, 0.5);
+        AlaColor c1 = palette.getPhaseColor(p1);
+        AlaColor c2 = palette.getPhaseColor(p2);
+        leds[x] = c1.interpolate8(c2, ALA_Q8_ONE/2);
+        p1 += d;
+        p2 += 2*d;
     }
 }
 
 
 void AlaLedRgb::fadeColors()
 {
-    float t = getStepFloat(animStartTime, speed, palette.numColors-1);
-    AlaColor c = palette.getPalColor(t);
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    alaq16_t t = phaseOf(palette.numColors-1);
+    AlaColor c = palette.getPalColor16(t);
+    fill(c);
 
 }
 
 void AlaLedRgb::pixelsFadeColors()
 {
-    float t = getStepFloat(animStartTime, speed, palette.numColors);
+    // Each pixel is 7 palette colors on from the last one.
+    uint32_t d = (uint32_t) ((((uint64_t) 7) << 32) / palette.numColors);
+    uint32_t p = framePhase;
 
     for(int x=0; x<numLeds; x++)
     {
-        AlaColor c = palette.getPalColor(t+7*x);
+        AlaColor c = palette.getPhaseColor(p);
         leds[x] = c;
+        p += d;
     }
 }
 
-void AlaLedRgb::fadeColorsLoop()
+// Heat rises from the start of the strip, cooling as it goes, and random
+// sparks near the bottom keep it going (after FastLED's Fire2012).  The
+// low byte of the option sets the cooling and the high byte how often
+// it sparks, out of 255 (0 for the defaults, 55 and 120).  The heat is
+// shown through the palette's heat table, or the fire palette's if it
+// hasn't one.  It moves on a step every frame, so it runs at the refresh
+// rate and ignores the speed.
+void AlaLedRgb::flame()
 {
-    float t = getStepFloat(animStartTime, speed, palette.numColors);
-    AlaColor c = palette.getPalColor(t);
-    for(int x=0; x<numLeds; x++)
+    unsigned int cooling = (option & 0xFF) ? (option & 0xFF) : 55;
+    unsigned int sparking = (option >> 8) ? (option >> 8) : 120;
+    const AlaColor *lut = palette.heat ? palette.heat : alaPalFire.heat;
+
+    if (heat == NULL)
+        return;
+
+    // Cool every pixel a little
+    unsigned int cooldown = (cooling * 10) / numLeds + 2;
+    for (int x=0; x<numLeds; x++)
     {
-        leds[x] = c;
+        unsigned int c = rng.below(cooldown);
+        heat[x] = (heat[x] > c) ? (heat[x] - c) : 0;
+    }
+
+    // Heat drifts up and spreads out: each pixel becomes the average of
+    // the two below it, the nearer counting twice (x171>>9 is /3).
+    for (int x=numLeds-1; x>=2; x--)
+    {
+        heat[x] = ((heat[x-1] + heat[x-2] + heat[x-2]) * 171) >> 9;
+    }
+
+    // Maybe a new spark near the bottom
+    if (rng.below(255) < sparking)
+    {
+        int y = rng.below((numLeds < 7) ? numLeds : 7);
+        unsigned int h = heat[y] + 160 + rng.below(96);
+        heat[y] = (h > 255) ? 255 : h;
+    }
+
+    for (int x=0; x<numLeds; x++)
+    {
+        leds[x] = lut[heat[x] >> (8 - ALA_PAL_LUTBITS)];
     }
 }
 
+void AlaLedRgb::fadeColorsLoop()
+{
+    AlaColor c = palette.getPhaseColor(framePhase);
+    fill(c);
+}
+
 
 void AlaLedRgb::cycleColors()
 {
-    int t = getStep(animStartTime, speed, palette.numColors);
+    int t = stepOf(palette.numColors);
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = palette.colors[t];
-    }
+    fill(palette.colors[t]);
 }
 
 void AlaLedRgb::idleWhite()
 {
     AlaColor c = AlaColor(10,10,10);    // a dim white
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    fill(c);
     animation = ALA_STOPSEQ;
 }
 
 void AlaLedRgb::soundPulse()
 {
-    bool isDone =  ((MILLIS()-animStartTime) >= (unsigned long) speed);
-    float s = (isDone) ? 1.0 : getStepFloat(animStartTime, speed, 1);
-    AlaColor c = palette.colors[0].scale(1-s);
+    alaq16_t s = progress();
+    bool isDone = (s == ALA_Q16_ONE);
+    AlaColor c = palette.colors[0].scale8(alaWave(wave, ALA_Q16_ONE-s));
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = c;
-    }
+    fill(c);
 
     // Stop our animation if we've run out the clock
     if (isDone) {
@@ -628,13 +1149,10 @@ void AlaLedRgb::onePixel()
 {
     AlaColor c = palette.colors[0];
 
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = 0;
-    }
+    clearLit();
 
     if (option < (unsigned int) numLeds) {
-        leds[option] = c;
+        light(option, c);
     }
 
     animation = ALA_STOPSEQ;
@@ -663,18 +1181,11 @@ void AlaLedRgb::grow()
 {
 //    AlaColor c = palette.colors[0];
     int numon;
-    long animtime;
     int x;
 
     // speed is the number of milliseconds to spread the animation out over.
     // The # of pixels to light is therefore (currentTime/speed)*numpixels
-    animtime = MILLIS() - animStartTime;
-
-    if (speed == 0) numon = numLeds;
-    else {
-        if (animtime >= speed) numon = numLeds;
-        else numon = (animtime * numLeds) / speed;
-    }
+    numon = (progress() * numLeds) >> 16;
 
     for (x = 0; x < numon; x++) {
         leds[x] = palette.colors[x % palette.numColors];
@@ -691,34 +1202,24 @@ void AlaLedRgb::pixelMarch()
     AlaColor c = palette.colors[0];
     AlaColor neighbors;
     int numon;
-    long animtime;
 
     // Start with nothing.
-    for(int x=0; x<numLeds; x++)
-    {
-        leds[x] = 0;
-    }
+    clearLit();
 
     // speed is the number of milliseconds to spread the animation out over.
     // The the index of the lit pixel is therefore (currentTime/speed)*numpixels
-    animtime = MILLIS() - animStartTime;
-
-    if (speed == 0) numon = numLeds;
-    else {
-        if (animtime >= speed) numon = numLeds;
-        else numon = (animtime * numLeds) / speed;
-    }
+    numon = (progress() * numLeds) >> 16;
     // should not be needed.
     if (numon >= numLeds) {
         return;
     }
 
     // make the neighbors dimmer than the center one.
-    neighbors = c.scale(0.1);
+    neighbors = c.scale8(26);      // 0.1
 
-    if (numon > 1) leds[numon-1] = neighbors;
-    leds[numon] = c;
-    if (numon < (numLeds-1)) leds[numon+1] = neighbors;
+    if (numon > 1) light(numon-1, neighbors);
+    light(numon, c);
+    if (numon < (numLeds-1)) light(numon+1, neighbors);
 
 }
 
@@ -726,18 +1227,11 @@ void AlaLedRgb::shrink()
 {
 //    AlaColor c = palette.colors[0];
     int numon;
-    long animtime;
     int x;
 
     // speed is the number of milliseconds to spread the animation out over.
     // The # of pixels to light is therefore (currentTime/speed)*numpixels
-    animtime = MILLIS() - animStartTime;
-
-    if (speed == 0) numon = numLeds;
-    else {
-        if (animtime >= speed) numon = numLeds;
-        else numon = (animtime * numLeds) / speed;
-    }
+    numon = (progress() * numLeds) >> 16;
 
     for (x = 0; x < numon; x++) {
         leds[x] = 0;
@@ -753,7 +1247,7 @@ void AlaLedRgb::shrink()
 
 void AlaLedRgb::movingBars()
 {
-    int t = getStep(animStartTime, speed, numLeds);
+    int t = stepOf(numLeds);
 
     for(int x=0; x<numLeds; x++)
     {
@@ -763,65 +1257,91 @@ void AlaLedRgb::movingBars()
 
 void AlaLedRgb::movingGradient()
 {
-    float t = getStepFloat(animStartTime, speed, numLeds);
+    uint32_t d = (uint32_t) ((((uint64_t) 1) << 32) / numLeds);
+    uint32_t p = framePhase;
 
     for(int x=0; x<numLeds; x++)
     {
-        leds[x] = palette.getPalColor((float)((x+t)*palette.numColors)/numLeds);
+        leds[x] = palette.getPhaseColor(p);
+        p += d;
     }
 }
 
 
 
-void AlaLedRgb::bouncingBalls()
+// Start the particles off at random heights, at rest.  Returns false
+// (with the strip cleared) if there are none to start.
+bool AlaLedRgb::startParticles()
 {
-    static long lastRefresh;
-
-    if (pxPos==NULL)
-    {
-        // allocate new arrays
-        pxPos = new float[palette.numColors];
-        pxSpeed = new float[palette.numColors];
-
-        for (int i=0; i<palette.numColors; i++)
+    if (particles.slot < 0) {
+        // No slot to be had (the pool could not be allocated): nothing
+        // to show.
+        for (int x=0; x<numLeds; x++)
         {
-            pxPos[i] = ((float)RANDOM(255))/255;
-            pxSpeed[i] = 0;
+            leds[x] = 0;
         }
-        lastRefresh = MILLIS();
+        return false;
+    }
 
+    int n = palette.numColors;
+    if (n > ALA_PARTICLES_PER_SLOT)
+        n = ALA_PARTICLES_PER_SLOT;
+
+    for (int i=0; i<n; i++)
+    {
+        particles.pos[i] = (rng.below(255)*ALA_Q16_ONE)/255;
+        particles.vel[i] = 0;
+    }
+    particles.count = n;
+    pxLastRefresh = frameTime;
+    return true;
+}
+
+// Positions and speeds are in Q16 strip lengths (per frame, for speeds).
+void AlaLedRgb::bouncingBalls()
+{
+    if (particles.count == 0)
+    {
+        startParticles();
         return; // skip the first cycle
     }
 
-    float speedReduction = (float)(MILLIS() - lastRefresh)/5000;
-    lastRefresh = MILLIS();
+    alaq16_t *pos = particles.pos;
+    alaq16_t *vel = particles.vel;
+
+    // Gravity: 1/5s^2
+    alaq16_t g = (alaq16_t) (((frameTime - pxLastRefresh) << 16) / 5000000);
+    pxLastRefresh = frameTime;
 
-    for (int i=0; i<palette.numColors; i++)
+    for (int i=0; i<particles.count; i++)
     {
-        if(pxSpeed[i]>-0.04 and pxSpeed[i]<0 and pxPos[i]>0 and pxPos[i]<0.1)
-            pxSpeed[i]=(0.09)-((float)RANDOM(10)/1000);
+        // A ball that has all but stopped near the bottom gets kicked
+        // back up (0.09 - 0..0.009).
+        if (vel[i]>-2621 && vel[i]<0 && pos[i]>0 && pos[i]<6554)
+            vel[i] = 5898-rng.below(10)*66;
 
-        pxPos[i] = pxPos[i] + pxSpeed[i];
-        if(pxPos[i]>=1)
+        pos[i] += vel[i];
+        if(pos[i]>=ALA_Q16_ONE)
         {
-            pxPos[i]=1;
+            pos[i]=ALA_Q16_ONE;
         }
-        if(pxPos[i]<0)
+        if(pos[i]<0)
         {
-            pxPos[i]=-pxPos[i];
-            pxSpeed[i]=-0.91*pxSpeed[i];
+            // Bounce, losing a little speed (x0.91)
+            pos[i]=-pos[i];
+            vel[i]=-(alaq16_t) (((int64_t) vel[i]*59638) >> 16);
         }
 
-        pxSpeed[i] = pxSpeed[i]-speedReduction;
+        vel[i] -= g;
     }
 
     for (int x=0; x<numLeds ; x++)
     {
         leds[x] = 0;
     }
-    for (int i=0; i<palette.numColors; i++)
+    for (int i=0; i<particles.count; i++)
     {
-        int p = mapfloat(pxPos[i], 0, 1, 0, numLeds-1);
+        int p = alaParticlePixel(pos[i], numLeds);
         leds[p] = leds[p].sum(palette.colors[i]);
     }
 
@@ -829,44 +1349,36 @@ void AlaLedRgb::bouncingBalls()
 
 void AlaLedRgb::bubbles()
 {
-    static long lastRefresh;
-
-    if (pxPos==NULL)
+    if (particles.count == 0)
     {
-        // allocate new arrays
-        pxPos = new float[palette.numColors];
-        pxSpeed = new float[palette.numColors];
-
-        for (int i=0; i<palette.numColors; i++)
-        {
-            pxPos[i] = ((float)RANDOM(255))/255;
-            pxSpeed[i] = 0;
-        }
-        lastRefresh = MILLIS();
-
+        startParticles();
         return; // skip the first cycle
     }
 
-    float speedDelta = (float)(MILLIS() - lastRefresh)/80000;
-    lastRefresh = MILLIS();
+    alaq16_t *pos = particles.pos;
+    alaq16_t *vel = particles.vel;
+
+    // Buoyancy: 1/80s^2
+    alaq16_t delta = (alaq16_t) (((frameTime - pxLastRefresh) << 16) / 80000000);
+    pxLastRefresh = frameTime;
 
-    for (int i=0; i<palette.numColors; i++)
+    for (int i=0; i<particles.count; i++)
     {
-        //pos[i] = pos[i] + speed[i];
-        if(pxPos[i]>=1)
+        if(pos[i]>=ALA_Q16_ONE)
         {
-            pxPos[i]=0;
-            pxSpeed[i]=0;
+            pos[i]=0;
+            vel[i]=0;
         }
-        if(RANDOM(20)==0 and pxPos[i]==0)
+        if(rng.below(20)==0 && pos[i]==0)
         {
-            pxPos[i]=0.0001;
-            pxSpeed[i]=0.0001;
+            // A new bubble, just off the bottom (0.0001)
+            pos[i]=7;
+            vel[i]=7;
         }
-        if(pxPos[i]>0)
+        if(pos[i]>0)
         {
-            pxPos[i] = pxPos[i] + pxSpeed[i];
-            pxSpeed[i] = pxSpeed[i] + speedDelta;
+            pos[i] += vel[i];
+            vel[i] += delta;
         }
     }
 
@@ -874,12 +1386,12 @@ void AlaLedRgb::bubbles()
     {
         leds[x] = 0;
     }
-    for (int i=0; i<palette.numColors; i++)
+    for (int i=0; i<particles.count; i++)
     {
-        if (pxPos[i]>0)
+        if (pos[i]>0)
         {
-            int p = mapfloat(pxPos[i], 0, 1, 0, numLeds-1);
-            AlaColor c = palette.colors[i].scale(1-(float)RANDOM(10)/30); // add a little flickering
+            int p = alaParticlePixel(pos[i], numLeds);
+            AlaColor c = palette.colors[i].scale8(ALA_Q8_ONE-(rng.below(10)*ALA_Q8_ONE)/30); // add a little flickering
             leds[p] = c;
         }
     }
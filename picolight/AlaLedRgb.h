@@ -17,6 +17,23 @@ typedef struct AlaSubStrip_s {
 
 #define MAXSUBSTRIPS 8
 
+// The point-like animations track this many lit pixels, so blit() need
+// only copy those and the ones they lit the frame before.
+#define ALA_MAXLIT 4
+#define ALA_MAXDIRTY (2*ALA_MAXLIT)
+
+// A substrip as blit() sees it: 'count' entries of leds[] starting at
+// 'src' go to 'strip' starting at pixel 'first' and moving by 'step' (+1
+// or -1), with the substrip's reverse flag and the animation direction
+// already folded in.
+typedef struct AlaRun_s {
+    Pico_NeoPixel *strip;
+    uint16_t src;
+    uint16_t first;
+    uint16_t count;
+    int8_t step;
+} AlaRun;
+
 /**
  *  AlaLedRgb can be used to drive a single or multiple RGB leds to perform animations.
  */
@@ -36,7 +53,8 @@ public:
     void begin(void);
 
     /**
-    * Sets the maximum brightness level.
+    * Sets the maximum brightness level of the physical strips this is
+    * drawn on.
     */
     void setBrightness(AlaColor maxOut);
 
@@ -50,6 +68,33 @@ public:
 
     void setAnimationSpeed(long speed);
 
+    /**
+    * Seeds the strip's random number generator, now and at the start of
+    * every animation, so the random effects repeat exactly.
+    */
+    void setSeed(uint32_t seed);
+
+    /**
+    * Post-processes every frame with 'flags' (ALA_POST_xxx, 0 for none).
+    * 'decay' is the fraction (Q8) of the last frame a trail keeps and
+    * 'blur' how much (Q8) of the neighbours' average goes into a pixel;
+    * 0 for either picks the default (ALA_DECAY_DEFAULT, all).  This
+    * applies from the next frame on, whatever the animation.
+    */
+    void setPostProcess(unsigned int flags, unsigned int decay, unsigned int blur);
+
+    /**
+    * Strips that would draw exactly the same frames (canShare()) can
+    * share them: a strip with a leader does no rendering of its own,
+    * and blit() copies the leader's frame out through its own substrips.
+    * setLeader(NULL) goes back to rendering.  setStartTime() lines up
+    * animations started together, so that they can be shared.
+    */
+    bool canShare(AlaLedRgb *other);
+    void setLeader(AlaLedRgb *leader);
+    inline AlaLedRgb *getLeader() { return leader; }
+    inline void setStartTime(uint64_t t) { animStartTime = t; }
+
 //    void setAnimation(int animation, long speed, unsigned int direction, AlaColor color);
     void setAnimation(int animation, long speed, unsigned int direction, unsigned int option, AlaPalette palette, AlaColor color);
 
@@ -60,12 +105,80 @@ public:
     int getAnimation();
 
     bool runAnimation();
+    bool runAnimation(uint64_t now);
+
+    /**
+    * runAnimation() in two steps.  render() updates this strip's own
+    * leds[] (and may run on either core) as of 'now', in microseconds,
+    * which the caller reads once per frame so that every strip sees
+    * the same instant; blit() then copies the result
+    * onto the physical strips, and must be called from one core in a
+    * fixed order since logical strips can overlap.  render() returns
+    * false when there is no new frame, which for the step-driven
+    * animations includes frames that would come out the same as the
+    * last one (see setAnimationFunc()); blit() returns false if it had
+    * nothing to copy.
+    */
+    bool render(uint64_t now);
+    bool blit();
+
+    /**
+    * Rough cost of one render(), for spreading strips across cores.
+    */
+    int getRenderCost();
+
+    /**
+    * What blit() copies where, for sending the physical strips straight
+    * from leds[] (see Pico_NeoPixelGather).  redraw() makes the next
+    * blit() copy the current frame again (all of it).
+    */
+    const AlaRun *getRuns(int *count) { *count = numRuns; return runs; }
+    const AlaColor *getLeds() { return leader ? leader->frame : frame; }
+    void redraw() { rendered = true; numDirty = -1; }
 
 
 
 private:
 
     void setAnimationFunc(int animation);
+    void setPhaseRate();
+
+    // Where this frame falls in the current 'speed' ms cycle, scaled to
+    // 0..v (stepOf) or 0..v in Q16 (phaseOf).  v must be under 32768.
+    inline int stepOf(int v) { return ((uint64_t) framePhase * v) >> 32; }
+    inline alaq16_t phaseOf(int v) { return ((uint64_t) framePhase * v) >> 16; }
+
+    // How far through the first 'speed' ms we are, in Q16, stopping at 1.
+    alaq16_t progress();
+
+    // Set every pixel to 'c'.  Rather than writing leds[], this just
+    // records the color, and blit() fills the physical strips with it
+    // directly.
+    inline void fill(AlaColor c) { solid = true; solidColor = c; }
+
+    // The animations that light a few pixels on black draw incrementally:
+    // clearLit() blacks out the pixels the last frame lit (or the whole
+    // strip, if leds[] holds anything else), then light() draws each
+    // pixel, and blit() only copies the pixels these touched.
+    void clearLit();
+    inline void light(int x, AlaColor c)
+    {
+        leds[x] = c;
+        if (numLit < ALA_MAXLIT)
+            lit[numLit++] = x;
+        else
+            litValid = false;   // Can't clear it next time; start over
+        touch(x);
+    }
+    inline void touch(int x)
+    {
+        if (numDirty < 0)
+            return;
+        if (numDirty < ALA_MAXDIRTY)
+            dirty[numDirty++] = x;
+        else
+            numDirty = -1;
+    }
     void stop();
     void on();
     void off();
@@ -88,6 +201,7 @@ private:
     void pixelShiftRight();
     void pixelShiftLeft();
     void pixelBounce();
+    void lightSmooth(alaq16_t h, AlaColor c);
     void pixelSmoothShiftRight();
     void pixelSmoothShiftLeft();
     void comet();
@@ -103,20 +217,38 @@ private:
     void plasma();
     void fadeColors();
     void pixelsFadeColors();
+    void flame();
     void fadeColorsLoop();
 
     void movingBars();
     void movingGradient();
 
+    bool startParticles();
     void bouncingBalls();
     void bubbles();
 
+    // Frame keys: everything the matching animation's frame depends on,
+    // so that an unchanged key means an unchanged frame.
+    uint64_t constKey();
+    uint64_t blinkKey();
+    uint64_t stroboKey();
+    uint64_t cycleColorsKey();
+    uint64_t movingBarsKey();
+    uint64_t pixelShiftKey();
+    uint64_t pixelBounceKey();
+    uint64_t progressKey();
+
     // Logical Strip Info
     AlaColor *leds; // array to store leds brightness values
+    AlaColor *frame;    // What blit() sends: leds[], or post[] if there is one
+    uint8_t *heat;  // flame(): how hot each pixel is (NULL until the first flame)
 
     // Physical Strip Info
     int numSubStrips;
     AlaSubStrip subStrips[MAXSUBSTRIPS];
+    int numRuns;
+    AlaRun runs[MAXSUBSTRIPS];
+    bool runsOverlap;   // Two runs write the same physical pixel
 
     int numLeds;
 
@@ -124,6 +256,7 @@ private:
     long speed;
     unsigned int option;
     unsigned int direction;
+    const uint16_t *wave;   // Curve for the fading animations (alaWave())
     AlaColor singleColor;
     AlaPalette palette;
     AlaSeq *animSeq;
@@ -131,18 +264,48 @@ private:
     long animSeqDuration;
 
     void (AlaLedRgb::*animFunc)();
-    AlaColor maxOut;
-    int refreshMillis;
+    uint64_t (AlaLedRgb::*keyFunc)();    // NULL: every frame is new
+    uint64_t frameKey;      // keyFunc() for the last frame rendered
+    bool frameKeyValid;
+    int refreshUs;
     int refreshRate;   // current refresh rate
-    unsigned long animStartTime;
+    uint64_t animStartTime;
     unsigned long animSeqStartTime;
-    unsigned long lastRefreshTime;
+    uint64_t lastRefreshTime;
+    uint64_t frameTime;     // 'now' for the frame being rendered (us)
+    uint32_t framePhase;    // Position in the animation cycle, 2^32 = 1 cycle
+    uint64_t phaseInc;      // framePhase per microsecond, in Q16
     unsigned long animSeqCount;
 
-    float *pxPos;
-    float *pxSpeed;
+    uint32_t seed;
+    AlaRandom rng;
+
+    AlaParticles particles;     // For the particle effects
+    uint64_t pxLastRefresh;
+
+    bool rendered;  // render() produced a frame that blit() hasn't copied
+    bool solid;     // The frame is solidColor all over; leds[] is stale
+    AlaColor solidColor;
+
+    int lit[ALA_MAXLIT];        // Pixels the last clearLit() frame lit
+    int numLit;
+    bool litValid;      // leds[] is black but for lit[]
+    bool litFrame;      // This frame was drawn with clearLit()
+    int dirty[ALA_MAXDIRTY];    // Pixels this frame changed...
+    int numDirty;       // ...or -1 for all of them
+
+    unsigned int postFlags;     // ALA_POST_xxx
+    unsigned int postDecay;     // Q8
+    unsigned int postBlur;      // Q8
+    AlaColor *post;     // The post-processed frame (NULL if postFlags is 0)
+    bool postFading;    // post[] still has a trail that hasn't faded out
+    void postProcess();
+
+    AlaLedRgb *leader;  // Whose frames we show, or NULL for our own
+    uint32_t frameSeq;  // Frames render() has produced
+    uint32_t leaderSeq; // The leader's frameSeq when we last blitted
 
-    bool findPixel(int idx, Pico_NeoPixel **strip, int *whichLed);
+    void buildRuns(void);
 
 };
 
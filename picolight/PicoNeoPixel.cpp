@@ -40,7 +40,8 @@
 
 // Constructor when length, pin and type are known at compile-time:
 Pico_NeoPixel::Pico_NeoPixel(ws2812pio_t *w, uint8_t p, uint16_t n, neoPixelType t) :
-  begun(false), brightness(0), pixels(NULL), endTime(0), wsp(w)
+  begun(false), gammaOn(false), outScaled(false), inFlight(false), dirtyEnd(0), brightness(0), pixels(NULL), front(NULL),
+  lut(NULL), maxOut(0xFFFFFF), trim(0xFFFFFF), keepAliveUs(NEO_KEEPALIVE_MS * 1000), sendBytes(0), gather(NULL), endTime(0), showTime(0), wsp(w)
 {
   updateType(t);
   setPin(p);
@@ -49,7 +50,11 @@ Pico_NeoPixel::Pico_NeoPixel(ws2812pio_t *w, uint8_t p, uint16_t n, neoPixelType
 
 
 Pico_NeoPixel::~Pico_NeoPixel() {
+  // DMA may still be reading our pixels[] buffer
+  ws2812_dma_wait(wsp);
   if(pixels)   free(pixels);
+  if(front)    free(front);
+  if(lut)      free(lut);
 }
 
 void Pico_NeoPixel::begin(void) {
@@ -59,7 +64,12 @@ void Pico_NeoPixel::begin(void) {
 }
 
 void Pico_NeoPixel::updateLength(uint16_t n) {
+  ws2812_dma_wait(wsp);    // Don't pull the buffer out from under the DMA
   if(pixels) free(pixels); // Free existing data (if any)
+  bool doubleBuffered = (front != NULL);
+  if(front) free(front);
+  front = NULL;
+  gather = NULL;           // It was for the old length
 
 
   // Allocate new data -- note: ALL PIXELS ARE CLEARED
@@ -67,11 +77,62 @@ void Pico_NeoPixel::updateLength(uint16_t n) {
   if((pixels = (uint8_t *)malloc(numBytes))) {
     memset(pixels, 0, numBytes);
     numLEDs = n;
+    markDirty();
+    if(doubleBuffered) setDoubleBuffered(true);
   } else {
     numLEDs = numBytes = 0;
   }
 }
 
+// Give the strip a second ("front") buffer for show() to transmit from,
+// so the next frame can be drawn into pixels[] while the last one is
+// still going out.  Returns false (and stays single-buffered) if there
+// is not enough memory.
+bool Pico_NeoPixel::setDoubleBuffered(bool on) {
+  if(on == (front != NULL)) return true;
+
+  ws2812_dma_wait(wsp);    // The front buffer may be going out
+  if(!on) {
+    free(front);
+    front = NULL;
+    return true;
+  }
+
+  if(!pixels || !(front = (uint8_t *)malloc(numBytes))) return false;
+  memcpy(front, pixels, numBytes);
+  return true;
+}
+
+// Send the strip straight from a DMA gather list (see
+// Pico_NeoPixelGather) and free pixels[], so the strip takes no frame
+// buffer of its own.  The list must cover the whole strip in wire order
+// and stay put while in use; the pixel-setting calls just mark the strip
+// dirty.  NULL goes back to a cleared, single-buffered pixels[]; returns
+// false if that can't be allocated.
+bool Pico_NeoPixel::setGather(const ws2812_gather_t *list) {
+  waitShown();             // Nothing may still be reading the old source
+  ws2812_dma_wait(wsp);
+
+  if(list) {
+    if(pixels) free(pixels);
+    if(front)  free(front);
+    pixels = front = NULL;
+  } else if(!pixels) {
+    if(!(pixels = (uint8_t *)malloc(numBytes))) return false;
+    memset(pixels, 0, numBytes);
+  }
+  gather = list;
+  markDirty();
+  return true;
+}
+
+// Wait until the last frame handed to transmit() has been sent, from
+// whichever core sent it.
+void Pico_NeoPixel::waitShown(void) {
+  while(inFlight.load(std::memory_order_acquire)) tight_loop_contents();
+  while(isShowing()) tight_loop_contents();
+}
+
 void Pico_NeoPixel::updateType(neoPixelType t) {
   bool oldThreeBytesPerPixel = (wOffset == rOffset); // false if RGBW
 
@@ -89,106 +150,295 @@ void Pico_NeoPixel::updateType(neoPixelType t) {
 }
 
 
-static inline uint32_t urgb_u32(uint8_t b0, uint8_t b1, uint8_t b2) {
-    return
-            ((uint32_t) (b0) << 16) |
-            ((uint32_t) (b1) << 8) |
-            (uint32_t) (b2);
+// Start sending the pixels to the strip.  pixels[] is already in wire
+// order, so it is handed straight to DMA (a byte per FIFO entry) and
+// this returns as soon as the transfer is started; use isShowing() to
+// find out when it is done.
+//
+// Single-buffered, pixels changed while the frame is going out may or
+// may not make it into it (they are resent by the next one).  Double-
+// buffered, pixels[] is swapped with the front buffer here and DMA reads
+// only the front, so drawing the next frame can overlap this one.
+//
+// show() is commit() followed by transmit(); Pico_NeoPixelPipe calls
+// them separately so the transmit can happen on the other core.
+void Pico_NeoPixel::show(void)
+{
+  if(commit()) transmit();
 }
 
-
-void Pico_NeoPixel::show(void)
+// Fix the current contents of pixels[] as the next frame to go out.
+// Returns false if there is nothing to send.
+bool Pico_NeoPixel::commit(void)
 {
-  uint8_t *pptr = pixels;
+  uint16_t count;
 
-  if(!pixels) return;
+  if(!pixels && !gather) return false;
 
+  // Nothing changed and the strip was refreshed recently enough.
+  if(!needsShow()) return false;
+
+  // Pixels past the last one that changed already hold the right data
+  // (a WS2812 keeps its color until it is sent a new one), so stop
+  // there.  Keep-alive refreshes always send the whole strip, as does
+  // a gather list.
+  count = (refreshDue() || gather) ? numLEDs : dirtyEnd;
+  sendBytes = count * ((wOffset == rOffset) ? 3 : 4);
+
+  // Our previous frame must have gone out and latched
   while(!canShow());
 
-  ws2812_pin_enable(wsp, pin);
-  for (uint i = 0; i < numLEDs; i++) {
-      pio_sm_put_blocking(wsp->pio, wsp->sm, (urgb_u32(pptr[0], pptr[1], pptr[2])) << 8u);
-      pptr += 3;
+  if(front) {
+    uint8_t *sent = front;
+    front = pixels;
+    pixels = sent;
+    // The old front is a frame behind, but only in the pixels changed
+    // since then, all of which are below dirtyEnd.  Bring those over so
+    // pixels[] matches what is going out.
+    memcpy(pixels, front, dirtyEnd * ((wOffset == rOffset) ? 3 : 4));
+  }
+
+  if(count == numLEDs) showTime = time_us_64();
+  dirtyEnd = 0;
+  return true;
+}
+
+// Send the frame fixed by the last commit().
+void Pico_NeoPixel::transmit(void)
+{
+  // If we share the state machine with another strip, wait for that
+  // one to finish and point the SM at our pin.  If it is ours alone it
+  // is already set up and idle (canShow() covered our last frame).
+  ws2812_dma_wait(wsp);
+  if(wsp->pin != pin) {
+    ws2812_quiesce(wsp);
+    ws2812_pin_enable(wsp, pin);
+  }
+  if(gather) {
+    ws2812_gather_start(wsp, gather);
+  } else {
+    ws2812_dma_start(wsp, front ? front : pixels, sendBytes);
   }
-  ws2812_quiesce(wsp);
 
-  endTime = time_us_64(); // Save EOD time for latch on next call
+  // Save expected EOD time for latch on next call.  Nobody waits for
+  // the latch except a show() of this same strip; another strip can use
+  // the SM as soon as the data is out.
+  endTime = time_us_64() + ws2812_frame_us(sendBytes);
+  wsp->busy_until = endTime;
 }
 
 // Set the output pin number
 void Pico_NeoPixel::setPin(uint8_t p) {
+    // Changing pindirs on a running state machine would corrupt
+    // a transfer in progress, so let it finish first.
+    ws2812_dma_wait(wsp);
+    ws2812_quiesce(wsp);
     pin = p;
     ws2812_pin_init(wsp, p);
+    wsp->pin = -1;          // Re-enable on next show()
+    markDirty();           // The strip on the new pin has none of our data
 }
 
 // Set pixel color from separate R,G,B components:
 void Pico_NeoPixel::setPixelColor(
  uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
 
-  if(n < numLEDs) {
-    if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
+  if((n < numLEDs) && pixels) {
+    mapOutput(r, g, b); // See notes in setBrightness()
     uint8_t *p;
     if(wOffset == rOffset) { // Is an RGB-type strip
       p = &pixels[n * 3];    // 3 bytes per pixel
     } else {                 // Is a WRGB-type strip
       p = &pixels[n * 4];    // 4 bytes per pixel
-      p[wOffset] = 0;        // But only R,G,B passed -- set W to 0
+      if(p[wOffset]) {       // But only R,G,B passed -- set W to 0
+        p[wOffset] = 0;
+        if(n >= dirtyEnd) dirtyEnd = n + 1;
+      }
+    }
+    if((p[rOffset] != r) || (p[gOffset] != g) || (p[bOffset] != b)) {
+      p[rOffset] = r;        // R,G,B always stored
+      p[gOffset] = g;
+      p[bOffset] = b;
+      if(n >= dirtyEnd) dirtyEnd = n + 1;
     }
-    p[rOffset] = r;          // R,G,B always stored
-    p[gOffset] = g;
-    p[bOffset] = b;
   }
 }
 
 void Pico_NeoPixel::setPixelColor(
  uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
 
-  if(n < numLEDs) {
-    if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-      w = (w * brightness) >> 8;
-    }
+  if((n < numLEDs) && pixels) {
+    mapOutput(r, g, b); // See notes in setBrightness()
+    if(brightness) w = (w * brightness) >> 8;
     uint8_t *p;
     if(wOffset == rOffset) { // Is an RGB-type strip
       p = &pixels[n * 3];    // 3 bytes per pixel (ignore W)
     } else {                 // Is a WRGB-type strip
       p = &pixels[n * 4];    // 4 bytes per pixel
-      p[wOffset] = w;        // Store W
+      if(p[wOffset] != w) {  // Store W
+        p[wOffset] = w;
+        if(n >= dirtyEnd) dirtyEnd = n + 1;
+      }
+    }
+    if((p[rOffset] != r) || (p[gOffset] != g) || (p[bOffset] != b)) {
+      p[rOffset] = r;        // Store R,G,B
+      p[gOffset] = g;
+      p[bOffset] = b;
+      if(n >= dirtyEnd) dirtyEnd = n + 1;
     }
-    p[rOffset] = r;          // Store R,G,B
-    p[gOffset] = g;
-    p[bOffset] = b;
   }
 }
 
 // Set pixel color from 'packed' 32-bit RGB color:
 void Pico_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
-  if(n < numLEDs) {
+  if((n < numLEDs) && pixels) {
     uint8_t *p,
       r = (uint8_t)(c >> 16),
       g = (uint8_t)(c >>  8),
       b = (uint8_t)c;
-    if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
+    mapOutput(r, g, b); // See notes in setBrightness()
     if(wOffset == rOffset) {
       p = &pixels[n * 3];
     } else {
       p = &pixels[n * 4];
       uint8_t w = (uint8_t)(c >> 24);
-      p[wOffset] = brightness ? ((w * brightness) >> 8) : w;
+      w = brightness ? ((w * brightness) >> 8) : w;
+      if(p[wOffset] != w) {
+        p[wOffset] = w;
+        if(n >= dirtyEnd) dirtyEnd = n + 1;
+      }
+    }
+    if((p[rOffset] != r) || (p[gOffset] != g) || (p[bOffset] != b)) {
+      p[rOffset] = r;
+      p[gOffset] = g;
+      p[bOffset] = b;
+      if(n >= dirtyEnd) dirtyEnd = n + 1;
+    }
+  }
+}
+
+// Copy 'count' packed G,R,B byte triples from 'grb' into the strip,
+// starting at pixel 'first' and going up (step 1) or down (step -1).
+// Each channel goes through the strip's output table, so this stores
+// exactly what setPixelColor(n, Color(...)) would.  Pixels that fall
+// off either end of the strip are skipped.
+void Pico_NeoPixel::setPixelRun(uint16_t first, int8_t step, uint16_t count,
+  const uint8_t *grb) {
+  if(!pixels) {            // Gathered: the data is sent from 'grb' itself
+    markDirty();
+    return;
+  }
+
+  if(step < 0) {
+    if(first >= numLEDs) {   // Skip the part past the end
+      uint16_t skip = first - (numLEDs - 1);
+      if(skip >= count) return;
+      grb   += 3 * skip;
+      count -= skip;
+      first  = numLEDs - 1;
+    }
+    if(count > first + 1) count = first + 1;
+  } else {
+    if(first >= numLEDs) return;
+    if(count > numLEDs - first) count = numLEDs - first;
+  }
+
+  uint8_t  bpp = (wOffset == rOffset) ? 3 : 4;
+  int      stride = step * bpp;
+  uint8_t *p = &pixels[first * bpp];
+  uint16_t n = first, hi = 0;
+
+  while(count--) {
+    uint8_t g = grb[0], r = grb[1], b = grb[2];
+    mapOutput(r, g, b); // See notes in setBrightness()
+    if((p[rOffset] != r) || (p[gOffset] != g) || (p[bOffset] != b) ||
+       ((bpp == 4) && p[wOffset])) {
+      if(bpp == 4) p[wOffset] = 0;
+      p[rOffset] = r;
+      p[gOffset] = g;
+      p[bOffset] = b;
+      if(n >= hi) hi = n + 1;
+    }
+    grb += 3;
+    p   += stride;
+    n   += step;
+  }
+
+  if(hi > dirtyEnd) dirtyEnd = hi;
+}
+
+// Fill 'count' pixels starting at 'first' (count 0 = to the end of the
+// strip) with packed color 'c'.  The pixel is laid out in wire order
+// once and then copied a word at a time (4 pixels = 3 words on an RGB
+// strip), only writing words that change, so the dirty range grows only
+// as far as the last pixel that really did.
+void Pico_NeoPixel::fill(uint32_t c, uint16_t first, uint16_t count) {
+  if(first >= numLEDs) return;
+  if(!pixels) {            // Gathered; see setPixelRun()
+    markDirty();
+    return;
+  }
+
+  uint16_t end = numLEDs;
+  if(count && (count < (numLEDs - first))) end = first + count;
+
+  uint8_t r = (uint8_t)(c >> 16), g = (uint8_t)(c >> 8), b = (uint8_t)c,
+          w = (uint8_t)(c >> 24);
+  mapOutput(r, g, b); // See notes in setBrightness()
+  if(brightness) w = (w * brightness) >> 8;
+
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  uint8_t px[4];
+  px[wOffset] = w;         // Overwritten by R below on an RGB strip
+  px[rOffset] = r;
+  px[gOffset] = g;
+  px[bOffset] = b;
+
+  uint8_t *p = &pixels[first * bpp], *e = &pixels[end * bpp], *changed = NULL;
+  uint8_t k = 0;           // Byte of px[] that goes at p
+
+  // Bytes up to the first word boundary
+  while(((uintptr_t)p & 3) && (p < e)) {
+    if(*p != px[k]) { *p = px[k]; changed = p; }
+    p++;
+    if(++k == bpp) k = 0;
+  }
+
+  // Whole words: the pattern repeats every 'bpp' words
+  uint32_t pat[4];
+  for(uint8_t i = 0; i < bpp; i++) {
+    pat[i] = 0;
+    for(uint8_t j = 0; j < 4; j++) {
+      pat[i] |= (uint32_t)px[k] << (8 * j);      // Little-endian
+      if(++k == bpp) k = 0;
+    }
+  }
+  uint32_t *wp = (uint32_t *)p;
+  uint32_t *we = wp + (e - p) / 4;
+  uint8_t i = 0;
+  while(wp < we) {
+    uint32_t diff = *wp ^ pat[i];
+    if(diff) {
+      *wp = pat[i];
+      changed = (uint8_t *)wp + (31 - __builtin_clz(diff)) / 8;
     }
-    p[rOffset] = r;
-    p[gOffset] = g;
-    p[bOffset] = b;
+    wp++;
+    if(++i == bpp) i = 0;
+  }
+
+  // Leftover bytes.  'k' is back where it was before the words (a whole
+  // number of patterns went out) plus whatever the partial one used.
+  p = (uint8_t *)wp;
+  k = (k + 4 * i) % bpp;
+  while(p < e) {
+    if(*p != px[k]) { *p = px[k]; changed = p; }
+    p++;
+    if(++k == bpp) k = 0;
+  }
+
+  if(changed) {
+    uint16_t n = (changed - pixels) / bpp + 1;
+    if(n > dirtyEnd) dirtyEnd = n;
   }
 }
 
@@ -204,48 +454,32 @@ uint32_t Pico_NeoPixel::Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
   return ((uint32_t)w << 24) | ((uint32_t)r << 16) | ((uint32_t)g <<  8) | b;
 }
 
-// Query color from previously-set pixel (returns packed 32-bit RGB value)
+// Query color from previously-set pixel (returns packed 32-bit RGB value).
+// This is the color as it goes out, after the output tables; there is
+// no getting back what was passed in.
 uint32_t Pico_NeoPixel::getPixelColor(uint16_t n) const {
-  if(n >= numLEDs) return 0; // Out of bounds, return no color.
+  if(n >= numLEDs || !pixels) return 0; // Out of bounds, return no color.
 
   uint8_t *p;
 
   if(wOffset == rOffset) { // Is RGB-type device
     p = &pixels[n * 3];
-    if(brightness) {
-      // Stored color was decimated by setBrightness().  Returned value
-      // attempts to scale back to an approximation of the original 24-bit
-      // value used when setting the pixel color, but there will always be
-      // some error -- those bits are simply gone.  Issue is most
-      // pronounced at low brightness levels.
-      return (((uint32_t)(p[rOffset] << 8) / brightness) << 16) |
-             (((uint32_t)(p[gOffset] << 8) / brightness) <<  8) |
-             ( (uint32_t)(p[bOffset] << 8) / brightness       );
-    } else {
-      // No brightness adjustment has been made -- return 'raw' color
-      return ((uint32_t)p[rOffset] << 16) |
-             ((uint32_t)p[gOffset] <<  8) |
-              (uint32_t)p[bOffset];
-    }
+    return ((uint32_t)p[rOffset] << 16) |
+           ((uint32_t)p[gOffset] <<  8) |
+            (uint32_t)p[bOffset];
   } else {                 // Is RGBW-type device
     p = &pixels[n * 4];
-    if(brightness) { // Return scaled color
-      return (((uint32_t)(p[wOffset] << 8) / brightness) << 24) |
-             (((uint32_t)(p[rOffset] << 8) / brightness) << 16) |
-             (((uint32_t)(p[gOffset] << 8) / brightness) <<  8) |
-             ( (uint32_t)(p[bOffset] << 8) / brightness       );
-    } else { // Return raw color
-      return ((uint32_t)p[wOffset] << 24) |
-             ((uint32_t)p[rOffset] << 16) |
-             ((uint32_t)p[gOffset] <<  8) |
-              (uint32_t)p[bOffset];
-    }
+    return ((uint32_t)p[wOffset] << 24) |
+           ((uint32_t)p[rOffset] << 16) |
+           ((uint32_t)p[gOffset] <<  8) |
+            (uint32_t)p[bOffset];
   }
 }
 
 // Returns pointer to pixels[] array.  Pixel data is stored in device-
 // native format and is not translated here.  Application will need to be
 // aware of specific pixel data format and handle colors appropriately.
+// Call markDirty() after changing pixels through this pointer.
 uint8_t *Pico_NeoPixel::getPixels(void) const {
   return pixels;
 }
@@ -254,18 +488,13 @@ uint16_t Pico_NeoPixel::numPixels(void) const {
   return numLEDs;
 }
 
-// Adjust output brightness; 0=darkest (off), 255=brightest.  This does
-// NOT immediately affect what's currently displayed on the LEDs.  The
-// next call to show() will refresh the LEDs at this level.  However,
-// this process is potentially "lossy," especially when increasing
-// brightness.  The tight timing in the WS2811/WS2812 code means there
-// aren't enough free cycles to perform this scaling on the fly as data
-// is issued.  So we make a pass through the existing color data in RAM
-// and scale it (subsequent graphics commands also work at this
-// brightness level).  If there's a significant step up in brightness,
-// the limited number of steps (quantization) in the old data will be
-// quite visible in the re-scaled version.  For a non-destructive
-// change, you'll need to re-render the full strip data.  C'est la vie.
+// Adjust output brightness; 0=darkest (off), 255=brightest.  Brightness,
+// maxOut, white-balance trim and gamma are folded into one table per
+// primary (see buildOutputLut()) that every pixel goes through as it is
+// stored, so changing any of them costs one table rebuild and no
+// per-pixel math.  Pixels already in the buffer keep their old levels
+// until they are set again; redraw the strip to apply a change to all
+// of it.  (White, on RGBW strips, just gets the brightness.)
 void Pico_NeoPixel::setBrightness(uint8_t b) {
   // Stored brightness value is different than what's passed.
   // This simplifies the actual scaling math later, allowing a fast
@@ -273,21 +502,63 @@ void Pico_NeoPixel::setBrightness(uint8_t b) {
   // adding 1 here may (intentionally) roll over...so 0 = max brightness
   // (color values are interpreted literally; no scaling), 1 = min
   // brightness (off), 255 = just below max brightness.
-  uint8_t newBrightness = b + 1;
-  if(newBrightness != brightness) { // Compare against prior value
-    // Brightness has changed -- re-scale existing data in RAM
-    uint8_t  c,
-            *ptr           = pixels,
-             oldBrightness = brightness - 1; // De-wrap old brightness value
-    uint16_t scale;
-    if(oldBrightness == 0) scale = 0; // Avoid /0
-    else if(b == 255) scale = 65535 / oldBrightness;
-    else scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
-    for(uint16_t i=0; i<numBytes; i++) {
-      c      = *ptr;
-      *ptr++ = (c * scale) >> 8;
+  brightness = b + 1;
+  buildOutputLut();
+}
+
+// Limit each primary to the matching byte of 'c' (0xRRGGBB).
+void Pico_NeoPixel::setMaxOut(uint32_t c) {
+  maxOut = c & 0xFFFFFF;
+  buildOutputLut();
+}
+
+// White-balance trim for this strip's LEDs, 0xRRGGBB (0xFFFFFF = none).
+void Pico_NeoPixel::setTrim(uint32_t c) {
+  trim = c & 0xFFFFFF;
+  buildOutputLut();
+}
+
+// Gamma-correct R,G,B with gamma8() after scaling.
+void Pico_NeoPixel::setGamma(bool on) {
+  gammaOn = on;
+  buildOutputLut();
+}
+
+// Entry v of each table is v scaled by that primary's maxOut, trim and
+// the brightness, each as (x+1)/256 so that 255 leaves it alone, then
+// gamma-corrected.  When that comes out as the identity the table is
+// dropped altogether.
+void Pico_NeoPixel::buildOutputLut(void) {
+  uint32_t k[3];
+  bool identity = !gammaOn;
+
+  for(int c = 0; c < 3; c++) {
+    uint32_t m = (maxOut >> (16 - 8 * c)) & 0xFF,
+             t = (trim   >> (16 - 8 * c)) & 0xFF;
+    k[c] = (m + 1) * (t + 1) * (brightness ? brightness : 256);
+    if(k[c] != ((uint32_t)1 << 24)) identity = false;
+  }
+
+  for(int c = 0; c < 3; c++) outK[c] = k[c];
+  outScaled = false;
+
+  if(identity) {
+    if(lut) free(lut);
+    lut = NULL;
+    return;
+  }
+
+  // Without room for the table, scale each pixel as it is stored
+  // instead (slower, but the brightness still holds).
+  if(!lut && !(lut = (uint8_t *)malloc(3 * 256))) {
+    outScaled = true;
+    return;
+  }
+
+  for(int c = 0; c < 3; c++) {
+    for(int v = 0; v < 256; v++) {
+      lut[c * 256 + v] = outputLevel(c, v);
     }
-    brightness = newBrightness;
   }
 }
 
@@ -297,7 +568,8 @@ uint8_t Pico_NeoPixel::getBrightness(void) const {
 }
 
 void Pico_NeoPixel::clear() {
-  memset(pixels, 0, numBytes);
+  if(pixels) memset(pixels, 0, numBytes);
+  markDirty();
 }
 
 /* A PROGMEM (flash mem) table containing 8-bit unsigned sine wave (0-255).
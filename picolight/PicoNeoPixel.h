@@ -19,7 +19,9 @@
 #ifndef PICO_NEOPIXEL_H
 #define PICO_NEOPIXEL_H
 
-#include "ws2812.pio.h"
+#include <atomic>
+
+#include "ws2812drv.h"
 
 
 // The order of primary colors in the NeoPixel data stream can vary
@@ -86,6 +88,10 @@
 
 typedef uint8_t neoPixelType;
 
+// Default keep-alive: how often show() resends a strip whose pixels have
+// not changed, so a strip that glitched or was hot-plugged recovers.
+#define NEO_KEEPALIVE_MS 1000
+
 class Pico_NeoPixel {
 
  public:
@@ -97,14 +103,24 @@ class Pico_NeoPixel {
 
     void begin(void);
     void show(void);
+    bool commit(void);
+    void transmit(void);
     void setPin(uint8_t p);
     void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
     void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w);
     void setPixelColor(uint16_t n, uint32_t c);
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
+    void setPixelRun(uint16_t first, int8_t step, uint16_t count, const uint8_t *grb);
     void setBrightness(uint8_t);
+    void setMaxOut(uint32_t c);
+    void setTrim(uint32_t c);
+    void setGamma(bool on);
     void clear(void);
     void updateLength(uint16_t n);
     void updateType(neoPixelType t);
+    bool setDoubleBuffered(bool on);
+    bool setGather(const ws2812_gather_t *list);
+    void waitShown(void);
 
     uint8_t *getPixels(void) const;
     uint8_t getBrightness(void) const;
@@ -112,16 +128,61 @@ class Pico_NeoPixel {
     uint8_t gamma8(uint8_t) const;
     int8_t getPin(void) { return pin; };
     uint16_t numPixels(void) const;
+    uint16_t getNumBytes(void) const { return numBytes; };
     static uint32_t Color(uint8_t r, uint8_t g, uint8_t b);
     static uint32_t Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w);
     uint32_t getPixelColor(uint16_t n) const;
-    inline bool canShow(void) { return (time_us_64() - endTime) >= 300L; }
+    inline bool canShow(void) { return (int64_t)(time_us_64() - endTime) >= WS2812_RESET_US; }
+    inline bool isShowing(void) { return (int64_t)(time_us_64() - endTime) < 0; }
+    inline bool isGathered(void) const { return gather != NULL; }
+    // True if pixels are scaled on the way in (brightness etc.), by the
+    // output table or, if there was no memory for one, by hand.
+    inline bool hasOutputLut(void) const { return (lut != NULL) || outScaled; }
+
+    // show() skips the strip unless a pixel has changed since the last
+    // transmission or the keep-alive interval (0 = never) has run out.
+    void setKeepAlive(uint32_t ms) { keepAliveUs = ms * 1000; };
+    inline void markDirty(void) { dirtyEnd = numLEDs; }
+    inline bool refreshDue(void) {
+      return keepAliveUs && ((time_us_64() - showTime) >= keepAliveUs);
+    }
+    inline bool needsShow(void) { return dirtyEnd || refreshDue(); }
 
  protected:
 
+  friend class Pico_NeoPixelBank;
+  friend class Pico_NeoPixelPipe;
+  friend class Pico_NeoPixelGather;
+
+  void buildOutputLut(void);
+
+  // Entry v of output table c, worked out from scratch.
+  inline uint8_t outputLevel(int c, uint8_t v) const {
+    uint8_t x = ((uint32_t)v * outK[c]) >> 24;
+    return gammaOn ? gamma8(x) : x;
+  }
+
+  // Put R,G,B through the output table, or the same sums without one.
+  inline void mapOutput(uint8_t &r, uint8_t &g, uint8_t &b) const {
+    if(lut) {
+      r = lut[r];
+      g = lut[256 + g];
+      b = lut[512 + b];
+    } else if(outScaled) {
+      r = outputLevel(0, r);
+      g = outputLevel(1, g);
+      b = outputLevel(2, b);
+    }
+  }
+
   bool
-    begun;         // true if begin() previously called
+    begun,         // true if begin() previously called
+    gammaOn,       // Gamma-correct R,G,B on the way in (see buildOutputLut())
+    outScaled;     // No room for lut[]: mapOutput() scales each pixel itself
+  std::atomic<bool>
+    inFlight;      // Handed to the output core and not yet latched
   uint16_t
+    dirtyEnd,      // 1 + highest pixel changed since the last show() (0 = clean)
     numLEDs,       // Number of RGB LEDs in strip
     numBytes;      // Size of 'pixels' buffer below (3 or 4 bytes/pixel)
   int8_t
@@ -129,12 +190,23 @@ class Pico_NeoPixel {
   uint8_t
     brightness,
    *pixels,        // Holds LED color values (3 or 4 bytes each)
+   *front,         // Copy being transmitted, if double-buffered (else NULL)
     rOffset,       // Index of red byte within each 3- or 4-byte pixel
     gOffset,       // Index of green byte
     bOffset,       // Index of blue byte
-    wOffset;       // Index of white byte (same as rOffset if no white)
+    wOffset,       // Index of white byte (same as rOffset if no white)
+   *lut;           // R,G,B output tables, 256 entries each (NULL = as is)
+  uint32_t
+    maxOut,        // Per-channel limit, 0xRRGGBB
+    trim,          // White balance, 0xRRGGBB
+    outK[3],       // Per-primary scale behind lut[], 1<<24 = 1.0
+    keepAliveUs,   // Resend an unchanged strip this often (0 = never)
+    sendBytes;     // Length of the frame fixed by commit()
+  const ws2812_gather_t
+   *gather;        // Sent from this instead of pixels[] (see setGather())
   uint64_t
-    endTime;       // Latch timing reference
+    endTime,       // Latch timing reference (expected end of transmission)
+    showTime;      // When the whole strip was last sent
 
   ws2812pio_t *wsp;
 };
@@ -0,0 +1,103 @@
+//
+// PicoNeoPixelBank.cpp
+// Parallel output for up to 16 Pico_NeoPixel strips.  See PicoNeoPixelBank.h.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "PicoNeoPixelBank.h"
+
+Pico_NeoPixelBank::Pico_NeoPixelBank(ws2812pio_t *w, uint8_t b) :
+  basePin(b), planes(NULL), planeBytes(0), transposeUs(0), endTime(0), wsp(w)
+{
+  for (int l = 0; l < WS2812_LANES; l++) {
+    lanes[l] = NULL;
+  }
+}
+
+Pico_NeoPixelBank::~Pico_NeoPixelBank() {
+  // DMA may still be reading our planes[] buffer
+  ws2812_dma_wait(wsp);
+  if(planes)   free(planes);
+}
+
+// Add a strip to the bank.  Its lane is determined by its pin, which
+// must be within the bank's range of pins.
+bool Pico_NeoPixelBank::attach(Pico_NeoPixel *strip)
+{
+  int lane = strip->getPin() - basePin;
+
+  if ((lane < 0) || (lane >= WS2812_LANES)) {
+    return false;
+  }
+
+  lanes[lane] = strip;
+  return true;
+}
+
+void Pico_NeoPixelBank::show(void)
+{
+  const uint8_t *src[WS2812_LANES];
+  uint16_t len[WS2812_LANES];
+  uint16_t maxBytes = 0;
+  uint32_t mask = 0;
+  uint64_t t0;
+
+  // All lanes go out together, so the frame is as long as the longest
+  // part any lane needs to send: up to its last changed pixel, or all
+  // of it for a keep-alive refresh.  Lanes that need less just resend
+  // data their strips already have.
+  for (int l = 0; l < WS2812_LANES; l++) {
+    src[l] = NULL;
+    len[l] = 0;
+    if (lanes[l] && lanes[l]->getPixels()) {
+      Pico_NeoPixel *s = lanes[l];
+      src[l] = s->getPixels();
+      len[l] = s->getNumBytes();
+      mask |= (1 << l);
+      uint16_t need = s->refreshDue() ? len[l] : (s->dirtyEnd * (len[l] / s->numLEDs));
+      if (need > maxBytes) maxBytes = need;
+    }
+  }
+
+  // Skipped entirely when every strip is clean.
+  if (maxBytes == 0) return;
+
+  // Once the DMA is done with planes[] we can build the next frame
+  // while the last one finishes going out and latches.
+  ws2812_dma_wait(wsp);
+
+  if (maxBytes > planeBytes) {
+    if(planes) free(planes);
+    if(!(planes = (uint32_t *)malloc((1 + 4 * maxBytes) * sizeof(uint32_t)))) {
+      planeBytes = 0;
+      return;
+    }
+    planeBytes = maxBytes;
+  }
+
+  t0 = time_us_64();
+  planes[0] = mask;
+  ws2812_transpose16(&planes[1], src, len, maxBytes);
+  transposeUs = (uint32_t) (time_us_64() - t0);
+
+  while(!canShow());
+
+  ws2812_parallel_start(wsp);
+  ws2812_dma_start(wsp, planes, 1 + 4 * maxBytes);
+
+  // Save expected EOD time for latch on next call
+  t0 = time_us_64();
+  endTime = t0 + ws2812_frame_us(maxBytes);
+  wsp->busy_until = endTime;
+
+  for (int l = 0; l < WS2812_LANES; l++) {
+    if (src[l]) {
+      lanes[l]->dirtyEnd = 0;
+      if (maxBytes >= len[l]) lanes[l]->showTime = t0;
+    }
+  }
+}
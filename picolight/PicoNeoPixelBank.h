@@ -0,0 +1,50 @@
+//
+// PicoNeoPixelBank.h
+// Drives up to 16 Pico_NeoPixel strips on consecutive pins at the same
+// time using the ws2812_parallel PIO program.  The strips keep their
+// own pixel buffers; show() bit-transposes them into one shared frame
+// and DMAs it out, so a frame takes as long as the longest strip rather
+// than the sum of all of them.
+//
+
+#ifndef PICO_NEOPIXELBANK_H
+#define PICO_NEOPIXELBANK_H
+
+#include "PicoNeoPixel.h"
+
+class Pico_NeoPixelBank {
+
+ public:
+
+  // wsp must have been set up with ws2812_parallel_program_init() on
+  // the WS2812_LANES pins starting at basePin.
+  Pico_NeoPixelBank(ws2812pio_t *wsp, uint8_t basePin);
+  ~Pico_NeoPixelBank();
+
+    bool attach(Pico_NeoPixel *strip);
+    void show(void);
+
+    inline bool canShow(void) { return (int64_t)(time_us_64() - endTime) >= WS2812_RESET_US; }
+    inline bool isShowing(void) { return (int64_t)(time_us_64() - endTime) < 0; }
+
+    // Time taken by the last transpose, for comparing against the
+    // sequential path.
+    uint32_t getTransposeTime(void) const { return transposeUs; };
+
+ protected:
+
+  uint8_t
+    basePin;       // GPIO of lane 0
+  Pico_NeoPixel
+   *lanes[WS2812_LANES];
+  uint32_t
+   *planes,        // Lane mask followed by 4 words per byte position
+    planeBytes,    // Byte positions 'planes' has room for
+    transposeUs;
+  uint64_t
+    endTime;       // Latch timing reference (expected end of transmission)
+
+  ws2812pio_t *wsp;
+};
+
+#endif // PICO_NEOPIXELBANK_H
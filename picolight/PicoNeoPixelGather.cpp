@@ -0,0 +1,171 @@
+//
+// PicoNeoPixelGather.cpp
+// Gather-list output for Pico_NeoPixel.  See PicoNeoPixelGather.h.
+//
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "PicoNeoPixelGather.h"
+
+// Black, for the parts of a strip that no piece covers.  Longer gaps
+// take several blocks.
+#define NEOGATHER_ZERO_PIXELS   64
+
+static uint8_t neoGatherZeros[NEOGATHER_ZERO_PIXELS * 3];
+
+Pico_NeoPixelGather::Pico_NeoPixelGather(Pico_NeoPixel *s) :
+  strip(s), attached(false), numSegs(0)
+{
+}
+
+Pico_NeoPixelGather::~Pico_NeoPixelGather()
+{
+    // The strip may outlive us; don't leave it pointing at our list.
+    if (attached) {
+        detach();
+    }
+}
+
+void Pico_NeoPixelGather::reset(void)
+{
+    numSegs = 0;
+}
+
+//
+// Segments are kept sorted and non-overlapping.  A new one cuts
+// whatever it covers out of the ones already there, splitting a segment
+// in two if it lands in the middle.
+//
+
+bool Pico_NeoPixelGather::add(uint16_t first, uint16_t count, const uint8_t *grb)
+{
+    Segment out[NEOGATHER_MAX_BLOCKS];
+    int n = 0;
+
+    if (first >= strip->numLEDs) {
+        return true;
+    }
+    if (count > strip->numLEDs - first) {
+        count = strip->numLEDs - first;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    uint32_t end = first + count;
+    bool placed = false;
+
+    for (int i = 0; i < numSegs; i++) {
+        Segment *s = &segs[i];
+        uint32_t sEnd = s->first + s->count;
+
+        // What is left of 's' before the new segment
+        if (s->first < first) {
+            if (n == NEOGATHER_MAX_BLOCKS) return false;
+            out[n].first = s->first;
+            out[n].count = ((sEnd < first) ? sEnd : first) - s->first;
+            out[n].grb = s->grb;
+            n++;
+        }
+
+        if (!placed && (sEnd > first)) {
+            if (n == NEOGATHER_MAX_BLOCKS) return false;
+            out[n].first = first;
+            out[n].count = count;
+            out[n].grb = grb;
+            n++;
+            placed = true;
+        }
+
+        // ...and after it
+        if (sEnd > end) {
+            uint16_t from = (s->first > end) ? s->first : end;
+            if (n == NEOGATHER_MAX_BLOCKS) return false;
+            out[n].first = from;
+            out[n].count = sEnd - from;
+            out[n].grb = s->grb + 3 * (from - s->first);
+            n++;
+        }
+    }
+
+    if (!placed) {
+        if (n == NEOGATHER_MAX_BLOCKS) return false;
+        out[n].first = first;
+        out[n].count = count;
+        out[n].grb = grb;
+        n++;
+    }
+
+    memcpy(segs, out, n * sizeof(Segment));
+    numSegs = n;
+    return true;
+}
+
+bool Pico_NeoPixelGather::addBlock(ws2812_gather_t *l, int *n, uint32_t count, const void *src)
+{
+    // Carry on from the last block if this one follows it in memory.
+    if ((*n > 0) && ((const uint8_t *) l[*n-1].read_addr + l[*n-1].count == src) &&
+        (src != neoGatherZeros)) {
+        l[*n-1].count += count;
+        return true;
+    }
+    if (*n == NEOGATHER_MAX_BLOCKS) {
+        return false;
+    }
+    l[*n].count = count;
+    l[*n].read_addr = src;
+    (*n)++;
+    return true;
+}
+
+bool Pico_NeoPixelGather::attach(void)
+{
+    ws2812_gather_t l[NEOGATHER_MAX_BLOCKS + 1];
+    uint16_t pos = 0;
+    int n = 0;
+
+    // The blocks are sent as they are, so the strip has to want exactly
+    // what AlaColor holds: G,R,B, with no output table to go through.
+    if ((strip->wOffset != strip->rOffset) || (strip->gOffset != 0) ||
+        (strip->rOffset != 1) || (strip->bOffset != 2) || strip->lut) {
+        return false;
+    }
+    if (!ws2812_gather_init(strip->wsp)) {
+        return false;
+    }
+
+    for (int i = 0; i <= numSegs; i++) {
+        uint16_t next = (i < numSegs) ? segs[i].first : strip->numLEDs;
+
+        while (pos < next) {
+            uint16_t gap = next - pos;
+            if (gap > NEOGATHER_ZERO_PIXELS) gap = NEOGATHER_ZERO_PIXELS;
+            if (!addBlock(l, &n, gap * 3, neoGatherZeros)) return false;
+            pos += gap;
+        }
+        if (i < numSegs) {
+            if (!addBlock(l, &n, segs[i].count * 3, segs[i].grb)) return false;
+            pos += segs[i].count;
+        }
+    }
+    l[n].count = 0;
+    l[n].read_addr = NULL;
+
+    // The strip may still be sending the old list.
+    strip->waitShown();
+    ws2812_dma_wait(strip->wsp);
+    memcpy(list, l, (n + 1) * sizeof(ws2812_gather_t));
+
+    attached = strip->setGather(list);
+    return attached;
+}
+
+bool Pico_NeoPixelGather::detach(void)
+{
+    if (!strip->setGather(NULL)) {
+        return false;
+    }
+    attached = false;
+    return true;
+}
@@ -0,0 +1,64 @@
+//
+// PicoNeoPixelGather.h
+// Builds the DMA gather list that sends a Pico_NeoPixel strip straight
+// out of the buffers it is drawn from (AlaLedRgb::leds, whose AlaColor
+// is already in NEO_GRB wire order), so the strip needs no pixel buffer
+// of its own.  Stretches of the strip that nothing covers are sent from
+// a shared block of zeros.
+//
+// Only forward runs can be gathered: a DMA channel can't read a buffer
+// backwards.  Strips with a reversed piece keep their pixel buffer.
+//
+
+#ifndef PICO_NEOPIXELGATHER_H
+#define PICO_NEOPIXELGATHER_H
+
+#include "PicoNeoPixel.h"
+
+// Most gather blocks per strip, zero padding included.
+#define NEOGATHER_MAX_BLOCKS    32
+
+class Pico_NeoPixelGather {
+
+ public:
+
+  Pico_NeoPixelGather(Pico_NeoPixel *strip);
+  ~Pico_NeoPixelGather();
+
+    // Start a new list.  The strip keeps sending the old one (if it is
+    // attached) until attach() or detach().
+    void reset(void);
+
+    // Send 'count' pixels from 'grb' (3 bytes each, wire order) as
+    // pixels 'first' on.  Where pieces overlap, the last one added wins.
+    // Returns false if the list is full.
+    bool add(uint16_t first, uint16_t count, const uint8_t *grb);
+
+    // Switch the strip over to the list built since reset(), freeing its
+    // pixel buffer.  Returns false (and leaves the strip alone) if the
+    // strip's format or the DMA channels don't allow it.
+    bool attach(void);
+
+    // Give the strip back a (cleared) pixel buffer.
+    bool detach(void);
+
+    inline bool isAttached(void) const { return attached; }
+
+ private:
+
+    typedef struct Segment_s {
+        uint16_t first;
+        uint16_t count;
+        const uint8_t *grb;
+    } Segment;
+
+    static bool addBlock(ws2812_gather_t *list, int *n, uint32_t count, const void *src);
+
+    Pico_NeoPixel *strip;
+    bool attached;
+    int numSegs;
+    Segment segs[NEOGATHER_MAX_BLOCKS];
+    ws2812_gather_t list[NEOGATHER_MAX_BLOCKS + 1];
+};
+
+#endif // PICO_NEOPIXELGATHER_H
@@ -0,0 +1,85 @@
+//
+// PicoNeoPixelPipe.cpp
+// Core1 output loop for Pico_NeoPixel.  See PicoNeoPixelPipe.h.
+//
+
+#include "pico/stdlib.h"
+#include "picocore.h"
+#include "PicoNeoPixelPipe.h"
+
+SpscQueue<Pico_NeoPixel *, NEOPIPE_DEPTH> Pico_NeoPixelPipe::queue;
+std::atomic<unsigned> Pico_NeoPixelPipe::submitted(0);
+std::atomic<unsigned> Pico_NeoPixelPipe::completed(0);
+
+void Pico_NeoPixelPipe::start(void)
+{
+    core1_launch(core1Main);
+}
+
+void Pico_NeoPixelPipe::submit(Pico_NeoPixel *strip)
+{
+    // Still going out (or latching) - try again next time around.
+    if (strip->inFlight.load(std::memory_order_acquire)) return;
+
+    if (!strip->commit()) return;
+
+    strip->inFlight.store(true, std::memory_order_relaxed);
+    submitted.store(submitted.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+
+    // Each strip is queued at most once, so this only spins if there
+    // are more than NEOPIPE_DEPTH strips.
+    while (!queue.push(strip)) {
+        tight_loop_contents();
+    }
+}
+
+void Pico_NeoPixelPipe::drain(void)
+{
+    unsigned target = submitted.load(std::memory_order_relaxed);
+
+    while (completed.load(std::memory_order_acquire) != target) {
+        tight_loop_contents();
+    }
+}
+
+//
+// Strips stay on the pending list from transmit() until they have
+// latched; only then is core0 allowed to commit them again, so a strip's
+// endTime and front buffer are only ever touched by one core at a time.
+//
+
+void Pico_NeoPixelPipe::core1Main(void)
+{
+    Pico_NeoPixel *pending[NEOPIPE_DEPTH];
+    Pico_NeoPixel *strip;
+    int npending = 0;
+
+    for (;;) {
+        while (queue.pop(strip)) {
+            strip->transmit();
+            pending[npending++] = strip;
+        }
+
+        for (int i = 0; i < npending; ) {
+            if (pending[i]->canShow()) {
+                // Let the DMA channel notice it is done with the strip
+                // before core0 can reuse its buffer (the host backend
+                // only completes a transfer, and hands it to its sink,
+                // when polled).
+                ws2812_dma_busy(pending[i]->wsp);
+                pending[i]->inFlight.store(false, std::memory_order_release);
+                completed.store(completed.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_release);
+                pending[i] = pending[--npending];
+            } else {
+                i++;
+            }
+        }
+
+        // Help out with whatever core0 has posted (e.g. rendering).
+        if (!core1_poll()) {
+            tight_loop_contents();
+        }
+    }
+}
@@ -0,0 +1,49 @@
+//
+// PicoNeoPixelPipe.h
+// Moves strip output onto the second core.  Core0 renders and calls
+// submit(), which fixes the strip's frame with commit() and queues the
+// strip; core1 pops it, calls transmit() and waits out the latch, so
+// long transmissions no longer hold up message handling or rendering.
+//
+// A strip is in the pipe at most once.  While it is in flight, submit()
+// leaves it alone and its changes simply accumulate for the next frame.
+//
+
+#ifndef PICO_NEOPIXELPIPE_H
+#define PICO_NEOPIXELPIPE_H
+
+#include "PicoNeoPixel.h"
+#include "spscqueue.h"
+
+// Most strips that can be in flight at once (a power of two).
+#define NEOPIPE_DEPTH   32
+
+class Pico_NeoPixelPipe {
+
+ public:
+
+    // Start the output loop on the other core.  Call once, after any
+    // strips used at startup have been shown directly.
+    static void start(void);
+
+    // Hand a strip's current frame to the output core (core0 only).
+    static void submit(Pico_NeoPixel *strip);
+
+    // Wait until everything submitted has been sent and latched, e.g.
+    // before deleting strips.
+    static void drain(void);
+
+ private:
+
+    static void core1Main(void);
+
+    static SpscQueue<Pico_NeoPixel *, NEOPIPE_DEPTH> queue;
+
+    // Strips handed over (written by core0 only) and strips latched
+    // (written by core1 only).  Plain loads and stores, since the M0+
+    // has no read-modify-write atomics; drain() waits for them to meet.
+    static std::atomic<unsigned> submitted;
+    static std::atomic<unsigned> completed;
+};
+
+#endif // PICO_NEOPIXELPIPE_H
@@ -0,0 +1,61 @@
+//
+// picocore.cpp
+// Second-core support.  See picocore.h.
+//
+
+#include <atomic>
+
+#include "pico/stdlib.h"
+#include "picocore.h"
+
+#if PICO_ON_DEVICE
+#include "pico/multicore.h"
+#else
+#include <thread>
+#endif
+
+static core1_job_t core1_job;
+static void *core1_arg;
+static std::atomic<bool> core1_posted(false);
+
+void core1_launch(void (*entry)(void))
+{
+#if PICO_ON_DEVICE
+    multicore_launch_core1(entry);
+#else
+    std::thread(entry).detach();
+#endif
+}
+
+void core1_idle_loop(void)
+{
+    for (;;) {
+        if (!core1_poll()) {
+            tight_loop_contents();
+        }
+    }
+}
+
+void core1_post(core1_job_t job, void *arg)
+{
+    core1_job = job;
+    core1_arg = arg;
+    core1_posted.store(true, std::memory_order_release);
+}
+
+void core1_wait(void)
+{
+    while (core1_posted.load(std::memory_order_acquire)) {
+        tight_loop_contents();
+    }
+}
+
+bool core1_poll(void)
+{
+    if (!core1_posted.load(std::memory_order_acquire)) {
+        return false;
+    }
+    (*core1_job)(core1_arg);
+    core1_posted.store(false, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,31 @@
+//
+// picocore.h
+// Second-core support.  core1_launch() starts a function on core1 (a
+// std::thread for host builds).  Whatever runs there calls core1_poll()
+// between its own work, so core0 can hand it one job at a time with
+// core1_post() and wait for it with core1_wait().
+//
+
+#ifndef PICOCORE_H
+#define PICOCORE_H
+
+#include "pico/stdlib.h"
+
+typedef void (*core1_job_t)(void *arg);
+
+// Start 'entry' on the other core.
+void core1_launch(void (*entry)(void));
+
+// Core1 entry for when there is nothing else for it to do but jobs.
+void core1_idle_loop(void);
+
+// Core0: hand core1 a job.  Only one may be outstanding.
+void core1_post(core1_job_t job, void *arg);
+
+// Core0: wait until the posted job has finished.
+void core1_wait(void);
+
+// Core1: run the posted job, if there is one.  Returns true if it did.
+bool core1_poll(void);
+
+#endif // PICOCORE_H
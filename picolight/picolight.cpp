@@ -19,6 +19,10 @@
 #include "ws2812.pio.h"
 
 #include "PicoNeoPixel.h"
+#include "PicoNeoPixelBank.h"
+#include "PicoNeoPixelPipe.h"
+#include "PicoNeoPixelGather.h"
+#include "picocore.h"
 #include "AlaLedRgb.h"
 
 #include "xtimer.h"
@@ -59,7 +63,64 @@ lsmessage_t txMessage;
 extern int displayInit(const char *name);
 extern int displayUpdate(void);
 
-ws2812pio_t wsp;
+//
+// Set PARALLEL_OUTPUT to 1 to send all of the physical strips at once
+// through the ws2812_parallel program instead of one after another.
+// This relies on all 16 ports being on consecutive pins (see pinMap).
+//
+
+#define PARALLEL_OUTPUT 0
+
+ws2812pio_t wspar;
+Pico_NeoPixelBank *pixelBank = NULL;
+
+//
+// Strips whose pixels have not changed are not resent, except once
+// every KEEPALIVE_MS so they recover from glitches and hot-plugging.
+//
+
+#define KEEPALIVE_MS 1000
+
+//
+// Set DOUBLE_BUFFER to give each physical strip a second pixel buffer, so
+// the next frame is rendered while the last one is still being sent.
+// Strips that don't fit in memory twice quietly stay single-buffered.
+// (The parallel bank keeps its own copy of the frame, so it doesn't
+// need this.)
+//
+
+#define DOUBLE_BUFFER 0
+
+//
+// Set MULTICORE_OUTPUT to send the physical strips from core1, leaving
+// core0 to handle messages and render.  Not used with PARALLEL_OUTPUT,
+// whose single transfer is already started without waiting.
+//
+
+#define MULTICORE_OUTPUT 0
+
+//
+// Set MULTICORE_RENDER to split the animation work for each frame
+// between both cores.  The logical strips are dealt out by estimated
+// cost (see AlaLedRgb::getRenderCost), both cores render their share
+// into the strips' own buffers, and once both are done core0 copies
+// them onto the physical strips in strip order.
+//
+
+#define MULTICORE_RENDER 0
+
+//
+// Set GATHER_OUTPUT to send each physical strip straight out of the
+// logical strips' own leds[] with a DMA gather list, rather than copying
+// them into a pixel buffer first, which saves the strip's buffer (3
+// bytes per LED, twice that if double-buffered).  Strips with a reversed
+// piece, an output table (brightness etc.) or no DMA channel to spare for
+// the list keep their buffers.  Rendering waits for gathered strips to finish
+// sending, since they are read from the buffers being rendered into.
+// Not used with PARALLEL_OUTPUT.
+//
+
+#define GATHER_OUTPUT 0
 
 /*  *********************************************************************
     *  Timer Stuff.  Macros are in xtimer.h
@@ -130,7 +191,9 @@ typedef struct PhysicalStrip_s {
     uint8_t pin;                        // Pin number for strips
     uint8_t flags;                      // Flags from the script
     uint16_t length;                    // total # of pixels on strip
+    ws2812pio_t *wsp;                   // PIO state machine driving it
     Pico_NeoPixel *neopixels;           // Neopixel object.
+    Pico_NeoPixelGather *gather;        // Sends it from leds[] (GATHER_OUTPUT)
 } PhysicalStrip_t;
 
 // Declare our global array of physical strips
@@ -147,12 +210,39 @@ PhysicalStrip_t physicalStrips[MAXPSTRIPS];
 typedef struct LogicalStrip_s {
     uint32_t substrips[MAXSUBSTRIPS];        // Encoded subset of pixels
     AlaLedRgb *alaStrip;                     // ALA object we created.
+    bool overlapped;                         // Shares pixels with an earlier strip
 } LogicalStrip_t;
 
 
 int logicalStripCount = 0;
 LogicalStrip_t logicalStrips[MAXVSTRIPS];
 
+//
+// Which logical strips each core renders, [0] for core0 and [1] for
+// core1.  Rebuilt whenever the animations change.
+//
+
+typedef struct RenderList_s {
+    int count;
+    uint8_t strips[MAXVSTRIPS];
+} RenderList_t;
+
+static RenderList_t renderLists[2];
+static bool renderPlanValid = false;
+static bool gatherPlanValid = false;
+static bool sharePlanValid = false;
+
+// The time, in microseconds, that every strip renders the current frame
+// for.  Read once per pass through loop().
+static uint64_t frameTime;
+
+// Set by LSCMD_BRIGHTNESS, for all of the physical strips.
+static uint8_t globalBrightness = 255;
+static bool globalGamma = false;
+
+// Set by LSCMD_SEED; see AlaLedRgb::setSeed().
+static uint32_t globalSeed = 0;
+
 
 
 /*  *********************************************************************
@@ -240,6 +330,7 @@ void setAnimation(uint32_t *strips, int animation, int speed, unsigned int direc
                   AlaPalette palette, AlaColor color)
 {
     int i;
+    uint64_t now = time_us_64();
 
     for (i = 0; i < logicalStripCount; i++) {
         // the "1 << i" means "shift 1 by 'i' positions to the left.
@@ -250,11 +341,249 @@ void setAnimation(uint32_t *strips, int animation, int speed, unsigned int direc
         if ((logicalStrips[i].alaStrip != NULL) &&
             ((strips[i/32] & ((uint32_t)1 << (i & 31))) != 0)) {
             logicalStrips[i].alaStrip->forceAnimation(animation, speed, direction, option, palette, color);
+            // All in step, so that they can share their frames.
+            logicalStrips[i].alaStrip->setStartTime(now);
             pushStrip(i);
         }
     }
+
+    // The costs have changed, and so may have which way the strips run.
+    renderPlanValid = false;
+    gatherPlanValid = false;
+    sharePlanValid = false;
+}
+
+
+/*  *********************************************************************
+    *  planShare()
+    *  
+    *  Find the logical strips that would draw the same frames as one
+    *  earlier in the table (typically when one animate command went to
+    *  many strips of the same length) and have them follow that one,
+    *  so the frame is only rendered once.  Each still copies it out to
+    *  its own substrips.
+    ********************************************************************* */
+
+static void planShare(void)
+{
+    for (int i = 0; i < logicalStripCount; i++) {
+        AlaLedRgb *alaStrip = logicalStrips[i].alaStrip;
+        AlaLedRgb *leader = NULL;
+
+        // The first match can't be following anything: whatever it
+        // follows would have matched first.
+        for (int j = 0; j < i; j++) {
+            if (alaStrip->canShare(logicalStrips[j].alaStrip)) {
+                leader = logicalStrips[j].alaStrip;
+                break;
+            }
+        }
+        alaStrip->setLeader(leader);
+    }
+
+    // Followers cost next to nothing, and are sent from their leaders'
+    // buffers.
+    renderPlanValid = false;
+    gatherPlanValid = false;
+    sharePlanValid = true;
+}
+
+
+/*  *********************************************************************
+    *  planRender()
+    *  
+    *  Split the logical strips between the two cores so that each
+    *  gets about the same amount of work.  Strips are handed out most
+    *  expensive first, each to whichever core has less so far (the
+    *  "longest processing time" rule), which gets within a few percent
+    *  of an even split for the kind of mix we see.
+    ********************************************************************* */
+
+static void planRender(void)
+{
+    int cost[MAXVSTRIPS];
+    uint8_t order[MAXVSTRIPS];
+    int load[2] = { 0, 0 };
+    int i, j;
+
+    // Sort by cost, highest first.  Only done when the animations
+    // change, so a simple insertion sort will do.
+    for (i = 0; i < logicalStripCount; i++) {
+        int c = logicalStrips[i].alaStrip->getRenderCost();
+        for (j = i; (j > 0) && (cost[j-1] < c); j--) {
+            cost[j] = cost[j-1];
+            order[j] = order[j-1];
+        }
+        cost[j] = c;
+        order[j] = i;
+    }
+
+    renderLists[0].count = 0;
+    renderLists[1].count = 0;
+
+    for (i = 0; i < logicalStripCount; i++) {
+        int core = (load[1] < load[0]) ? 1 : 0;
+        renderLists[core].strips[renderLists[core].count++] = order[i];
+        load[core] += cost[i];
+    }
+
+    renderPlanValid = true;
+}
+
+static void renderJob(void *arg)
+{
+    RenderList_t *list = (RenderList_t *) arg;
+
+    for (int i = 0; i < list->count; i++) {
+        logicalStrips[list->strips[i]].alaStrip->render(frameTime);
+    }
 }
 
+/*  *********************************************************************
+    *  findOverlaps()
+    *  
+    *  Mark the logical strips that share physical pixels with one
+    *  earlier in the table.  Those have to be copied out again whenever
+    *  an earlier strip is, even with no new frame of their own, so
+    *  that they still win.
+    ********************************************************************* */
+
+static void runSpan(const AlaRun *run, int *lo, int *hi)
+{
+    if (run->step > 0) {
+        *lo = run->first;
+        *hi = run->first + run->count;
+    } else {
+        *lo = run->first - run->count + 1;
+        *hi = run->first + 1;
+    }
+}
+
+static bool runsOverlap(AlaLedRgb *a, AlaLedRgb *b)
+{
+    int na, nb;
+    const AlaRun *ra = a->getRuns(&na);
+    const AlaRun *rb = b->getRuns(&nb);
+
+    for (int i = 0; i < na; i++) {
+        for (int j = 0; j < nb; j++) {
+            int alo, ahi, blo, bhi;
+            if (ra[i].strip != rb[j].strip) {
+                continue;
+            }
+            runSpan(&ra[i], &alo, &ahi);
+            runSpan(&rb[j], &blo, &bhi);
+            if ((alo < bhi) && (blo < ahi)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void findOverlaps(void)
+{
+    for (int j = 0; j < logicalStripCount; j++) {
+        logicalStrips[j].overlapped = false;
+        for (int i = 0; i < j; i++) {
+            if (runsOverlap(logicalStrips[i].alaStrip, logicalStrips[j].alaStrip)) {
+                logicalStrips[j].overlapped = true;
+                break;
+            }
+        }
+    }
+}
+
+// Copy the new frames out to the physical strips.  Logical strips can
+// share physical pixels, so this goes in a fixed order (the last one
+// wins, as before).
+static void blitAll(void)
+{
+    bool blitted = false;
+
+    for (int i = 0; i < logicalStripCount; i++) {
+        if (blitted && logicalStrips[i].overlapped) {
+            logicalStrips[i].alaStrip->redraw();
+        }
+        blitted |= logicalStrips[i].alaStrip->blit();
+    }
+}
+
+/*  *********************************************************************
+    *  planGather()
+    *  
+    *  Work out which physical strips can be sent straight from the
+    *  logical strips' leds[] (see GATHER_OUTPUT) and hand them their
+    *  gather lists.  The rest get their pixel buffers back.  Redone
+    *  whenever the animations change, since the direction does.
+    ********************************************************************* */
+
+#if GATHER_OUTPUT && !PARALLEL_OUTPUT
+
+// Have every logical strip that feeds 'strip' copy its frame out again.
+static void redrawStrip(Pico_NeoPixel *strip)
+{
+    for (int i = 0; i < logicalStripCount; i++) {
+        int nruns;
+        const AlaRun *runs = logicalStrips[i].alaStrip->getRuns(&nruns);
+
+        for (int r = 0; r < nruns; r++) {
+            if (runs[r].strip == strip) {
+                logicalStrips[i].alaStrip->redraw();
+                break;
+            }
+        }
+    }
+}
+
+static void planGather(void)
+{
+    for (int p = 0; p < MAXPSTRIPS; p++) {
+        Pico_NeoPixel *strip = physicalStrips[p].neopixels;
+        Pico_NeoPixelGather *gather = physicalStrips[p].gather;
+        bool ok = true;
+
+        if (!gather) {
+            continue;
+        }
+
+        // Add the pieces in blit() order, so that where logical strips
+        // overlap the same one wins.
+        gather->reset();
+        for (int i = 0; ok && (i < logicalStripCount); i++) {
+            AlaLedRgb *alaStrip = logicalStrips[i].alaStrip;
+            int nruns;
+            const AlaRun *runs = alaStrip->getRuns(&nruns);
+
+            for (int r = 0; ok && (r < nruns); r++) {
+                if (runs[r].strip != strip) {
+                    continue;
+                }
+                ok = (runs[r].step > 0) &&
+                    gather->add(runs[r].first, runs[r].count, alaStrip->getLeds()[runs[r].src].raw);
+            }
+        }
+
+        if (ok && gather->attach()) {
+            // A solid frame isn't in leds[] until blit() puts it there.
+            redrawStrip(strip);
+            continue;
+        }
+
+        if (gather->isAttached()) {
+            gather->detach();
+            redrawStrip(strip);
+        }
+#if DOUBLE_BUFFER
+        strip->setDoubleBuffered(true);
+#endif
+    }
+
+    gatherPlanValid = true;
+}
+
+#endif
+
 /*  *********************************************************************
     *  reset_all()
     *  
@@ -282,11 +611,34 @@ static void reset_all(void)
         if (logicalStrips[i].alaStrip) {
             delete logicalStrips[i].alaStrip;
             logicalStrips[i].alaStrip = NULL;
+            logicalStrips[i].overlapped = false;
             for (int j = 0; j < MAXSUBSTRIPS; j++) logicalStrips[i].substrips[j] = 0;
         }
     }
 
     logicalStripCount = 0;
+    renderPlanValid = false;
+    gatherPlanValid = false;
+    sharePlanValid = false;
+
+#if MULTICORE_OUTPUT && !PARALLEL_OUTPUT
+    // Core1 may still be sending some of the strips.
+    Pico_NeoPixelPipe::drain();
+#endif
+
+    // The gather lists point into the strips, so they go first.
+    for (i = 0; i < MAXPSTRIPS; i++) {
+        if (physicalStrips[i].gather) {
+            delete physicalStrips[i].gather;
+            physicalStrips[i].gather = NULL;
+        }
+    }
+
+    // The bank refers to the physical strips, so it goes first.
+    if (pixelBank) {
+        delete pixelBank;
+        pixelBank = NULL;
+    }
 
     // Now erase the physical strips
 
@@ -297,9 +649,12 @@ static void reset_all(void)
             physicalStrips[i].length = 0;
             physicalStrips[i].flags = 0;
             physicalStrips[i].pin = 0;
+            physicalStrips[i].wsp = NULL;
         }
     }
 
+    ws2812_channel_reset();
+
     globalState = GSTATE_INIT;
 }
 
@@ -318,19 +673,45 @@ static void init_all(void)
 
     // Walk the physical strip table as uploaded from lightscript and
     // instantiate the real strips.
+    // Each strip gets its own state machine, as long as they last.
     for (i = 0; i < MAXPSTRIPS; i++) {
         if (physicalStrips[i].length != 0) {
+            physicalStrips[i].wsp = ws2812_channel_alloc();
             physicalStrips[i].neopixels =
-                new Pico_NeoPixel(&wsp, physicalStrips[i].pin, physicalStrips[i].length, NEO_GRB);
+                new Pico_NeoPixel(physicalStrips[i].wsp, physicalStrips[i].pin, physicalStrips[i].length, NEO_GRB);
             if (!physicalStrips[i].neopixels) {
                 displayInit("ERR1");
                 displayUpdate();
                 printf("Out of memory creating physcial strips\n");
             }
+            physicalStrips[i].neopixels->setKeepAlive(KEEPALIVE_MS);
+            physicalStrips[i].neopixels->setGamma(globalGamma);
+            physicalStrips[i].neopixels->setBrightness(globalBrightness);
+#if GATHER_OUTPUT && !PARALLEL_OUTPUT
+            // planGather() decides which strips keep their buffers (and
+            // double-buffers those), so don't make them any bigger yet.
+            physicalStrips[i].gather = new Pico_NeoPixelGather(physicalStrips[i].neopixels);
+#elif DOUBLE_BUFFER && !PARALLEL_OUTPUT
+            physicalStrips[i].neopixels->setDoubleBuffered(true);
+#endif
             physicalStrips[i].neopixels->begin();
         }
     }
 
+#if PARALLEL_OUTPUT
+    // Hand the physical strips to the parallel output bank.  The
+    // per-channel state machines are parked so they leave the pins alone,
+    // and the pins are handed back to the parallel state machine's PIO.
+    ws2812_pool_stop();
+    pixelBank = new Pico_NeoPixelBank(&wspar, PORT_B1);
+    for (i = 0; i < MAXPSTRIPS; i++) {
+        if (physicalStrips[i].neopixels) {
+            ws2812_pin_init(&wspar, physicalStrips[i].pin);
+            pixelBank->attach(physicalStrips[i].neopixels);
+        }
+    }
+#endif
+
     // Now init the virtual strips.
     for (i = 0; i < MAXVSTRIPS; i++) {
         // Zero is not a valid encoded substrip, especially for the first substrip
@@ -377,6 +758,7 @@ static void init_all(void)
     for (i = 0; i < MAXVSTRIPS; i++) {
         if (logicalStrips[i].alaStrip) {
             logicalStrips[i].alaStrip->begin();
+            logicalStrips[i].alaStrip->setSeed(alaMixSeed(globalSeed, i));
         } else {
             break;
         }
@@ -386,6 +768,19 @@ static void init_all(void)
     // In our main loop we don't necessarily want to walk all 128 table
     // entries if we've only defined a few strips.
     logicalStripCount = i;
+    renderPlanValid = false;
+    sharePlanValid = false;
+
+    // One particle slot for every logical strip (ALA_PARTICLES_PER_SLOT
+    // particles of 8 bytes, so 32KB at most), so that any of them can
+    // run a particle effect.
+    alaParticlePoolInit(i);
+    findOverlaps();
+
+#if GATHER_OUTPUT && !PARALLEL_OUTPUT
+    // Free what pixel buffers we can before anything else is allocated.
+    planGather();
+#endif
 
     // Init the strip stack
     for (i = 0; i < MAXVSTRIPS; i++) {
@@ -421,7 +816,14 @@ void setup()
 
     // Set up the Pico's programmable IO pins.
 
-    ws2812_program_init(&wsp, pio0, 0, 800000);
+#if PARALLEL_OUTPUT
+    // PORT_B1..B8 and PORT_A1..A8 are GPIO6..21, one lane each.
+    ws2812_parallel_program_init(&wspar, pio0, 0, PORT_B1, WS2812_LANES, 800000);
+    ws2812_dma_init(&wspar, 4);
+#endif
+
+    // Everything else is available to the per-channel state machines.
+    ws2812_pool_init(800000);
 
     // Probably don't need to call reset_all() at power-on but...
 
@@ -558,6 +960,78 @@ static void handleAnimationMessage(lsmessage_t *msg)
 
 static void handleBrightnessMessage(lsmessage_t *msg)
 {
+    lsbrightness_t *bmsg = &(msg->info.ls_brightness);
+    int i;
+
+    if (msg->ls_length >= 1) {
+        globalBrightness = bmsg->lb_brightness;
+    }
+    if (msg->ls_length >= 2) {
+        globalGamma = (bmsg->lb_flags & LSBRIGHT_GAMMA) != 0;
+    }
+
+    // Each of these just rebuilds the strip's output tables.
+    for (i = 0; i < MAXPSTRIPS; i++) {
+        Pico_NeoPixel *strip = physicalStrips[i].neopixels;
+        if (strip == NULL) {
+            continue;
+        }
+        if ((msg->ls_length >= sizeof(lsbrightness_t)) && (bmsg->lb_pstrips & (1 << i))) {
+            strip->setTrim(bmsg->lb_trim);
+        }
+        strip->setGamma(globalGamma);
+        strip->setBrightness(globalBrightness);
+    }
+
+    // The strips hold their pixels as they go out, so have every logical
+    // strip copy its frame through the new tables.
+    for (i = 0; i < logicalStripCount; i++) {
+        logicalStrips[i].alaStrip->redraw();
+    }
+
+    // Strips that now have a table can't be sent straight from leds[].
+    gatherPlanValid = false;
+
+    // No response is sent for this one.
+}
+
+static void handleSeedMessage(lsmessage_t *msg)
+{
+    globalSeed = msg->info.ls_seed.ls_seed;
+
+    for (int i = 0; i < logicalStripCount; i++) {
+        logicalStrips[i].alaStrip->setSeed(alaMixSeed(globalSeed, i));
+    }
+
+    // No response is sent for this one.
+}
+
+static void handlePostProcessMessage(lsmessage_t *msg)
+{
+    lspost_t *pmsg = &(msg->info.ls_post);
+
+#if GATHER_OUTPUT && !PARALLEL_OUTPUT
+    // A gathered strip may still be sending the buffer that goes away.
+    for (int p = 0; p < MAXPSTRIPS; p++) {
+        if (physicalStrips[p].gather && physicalStrips[p].gather->isAttached()) {
+            physicalStrips[p].neopixels->waitShown();
+        }
+    }
+#endif
+
+    // The LSPOST_xxx flags are the ALA_POST_xxx ones.
+    for (int i = 0; i < logicalStripCount; i++) {
+        if ((pmsg->lp_strips[i/32] & ((uint32_t)1 << (i & 31))) != 0) {
+            logicalStrips[i].alaStrip->setPostProcess(pmsg->lp_flags, pmsg->lp_decay, pmsg->lp_blur);
+        }
+    }
+
+    // The costs have changed, and so have the buffers the strips are
+    // sent from, and post-processed strips don't share.
+    renderPlanValid = false;
+    gatherPlanValid = false;
+    sharePlanValid = false;
+
     // No response is sent for this one.
 }
 
@@ -648,6 +1122,12 @@ static void handleMessage(lsmessage_t *msg)
         case LSCMD_IDLE:
             handleIdleMessage(msg);
             break;
+        case LSCMD_SEED:
+            handleSeedMessage(msg);
+            break;
+        case LSCMD_POSTPROCESS:
+            handlePostProcessMessage(msg);
+            break;
         case LSCMD_VERSION:
             handleVersionMessage(msg);
             break;
@@ -734,7 +1214,7 @@ void first_time_idle(void)
 {
     int i;
     // create a single physical strip of 256 LEDs.
-    Pico_NeoPixel *pixels = new Pico_NeoPixel(&wsp, PORT_A1, 256, NEO_GRB);
+    Pico_NeoPixel *pixels = new Pico_NeoPixel(ws2812_channel_alloc(), PORT_A1, 256, NEO_GRB);
 
     pixels->begin();
     
@@ -749,6 +1229,7 @@ void first_time_idle(void)
     }
 
     delete pixels;
+    ws2812_channel_reset();
 }
 
 
@@ -779,23 +1260,59 @@ void loop()
     //
 
     if (globalState == GSTATE_READY) {
+        if (!sharePlanValid) {
+            planShare();
+        }
+
+#if GATHER_OUTPUT && !PARALLEL_OUTPUT
+        if (!gatherPlanValid) {
+            planGather();
+        }
+
+        // Gathered strips are sent from the very leds[] we're about to
+        // render into, so let them finish first.
+        for (i = 0; i < MAXPSTRIPS; i++) {
+            if (physicalStrips[i].gather && physicalStrips[i].gather->isAttached()) {
+                physicalStrips[i].neopixels->waitShown();
+            }
+        }
+#endif
+
+        frameTime = time_us_64();
+
         // First compute new pixels on the LOGICAL Strips
-#if 0
+#if MULTICORE_RENDER
+        if (!renderPlanValid) {
+            planRender();
+        }
+        core1_post(renderJob, &renderLists[1]);
+        renderJob(&renderLists[0]);
+        core1_wait();
+#elif 0
         for (i = logicalStripCount-1; i >= 0; i--) {
             if (stripStack[i] != -1) {
-                logicalStrips[stripStack[i]].alaStrip->runAnimation();
+                logicalStrips[stripStack[i]].alaStrip->runAnimation(frameTime);
             }
         }
 #else
         for (i = 0; i < logicalStripCount; i++) {
-            logicalStrips[i].alaStrip->runAnimation();
+            logicalStrips[i].alaStrip->render(frameTime);
         }
 #endif
+        blitAll();
 
         // Now send the data to the PHYSICAL strips
-        for (i = 0; i < MAXPSTRIPS; i++) {
-            if (physicalStrips[i].neopixels != NULL) {
-                physicalStrips[i].neopixels->show();
+        if (pixelBank) {
+            pixelBank->show();
+        } else {
+            for (i = 0; i < MAXPSTRIPS; i++) {
+                if (physicalStrips[i].neopixels != NULL) {
+#if MULTICORE_OUTPUT && !PARALLEL_OUTPUT
+                    Pico_NeoPixelPipe::submit(physicalStrips[i].neopixels);
+#else
+                    physicalStrips[i].neopixels->show();
+#endif
+                }
             }
         }
     }
@@ -820,6 +1337,11 @@ int main()
 
     setup();
     first_time_idle();
+#if MULTICORE_OUTPUT && !PARALLEL_OUTPUT
+    Pico_NeoPixelPipe::start();
+#elif MULTICORE_RENDER
+    core1_launch(core1_idle_loop);
+#endif
     TIMER_SET(displayUpdateTimer, 5000);
     for (;;) {
         loop();
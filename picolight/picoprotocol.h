@@ -37,6 +37,8 @@
 #define LSCMD_ANIMATE           0               // Send an animation command
 #define LSCMD_BRIGHTNESS        1               // Send a global brightness command
 #define LSCMD_IDLE              2               // Idle the panel
+#define LSCMD_SEED              3               // Seed the random effects
+#define LSCMD_POSTPROCESS       4               // Set post-processing
 
 #define LSCMD_VERSION           0x80            // Firmware version
 #define LSCMD_STATUS            0x81            // Return info about current setup
@@ -53,6 +55,43 @@ typedef struct __attribute__((packed)) lsanimate_s {
     uint32_t    la_strips[MAXVSTRIPS/32];
 } lsanimate_t;
 
+// Brightness applies to every physical strip.  A shorter message leaves
+// the fields it doesn't reach alone (so a 1-byte one just sets the
+// brightness); lb_trim goes to the physical strips in lb_pstrips.
+#define LSBRIGHT_GAMMA          0x01            // Gamma-correct the output
+
+typedef struct __attribute__((packed)) lsbrightness_s {
+    uint8_t     lb_brightness;                  // 0 (off) to 255 (full)
+    uint8_t     lb_flags;                       // LSBRIGHT_xxx
+    uint16_t    lb_pstrips;                     // Bitmask of physical strips
+    uint32_t    lb_trim;                        // White balance, 0xRRGGBB
+} lsbrightness_t;
+
+// Each logical strip's generator is seeded from this and its index, and
+// reseeded at the start of every animation, so controllers given the
+// same seed produce the same random effects.
+typedef struct __attribute__((packed)) lsseed_s {
+    uint32_t    ls_seed;
+} lsseed_t;
+
+// Post-processing for the logical strips in lp_strips, done to every
+// frame whatever the animation.  lp_flags 0 turns it off.  lp_decay is
+// how much of the old frame a trail keeps and lp_blur how much a pixel
+// is blended with its neighbours, both out of 256 (0 for the defaults:
+// 0.88 and all).
+#define LSPOST_MIRROR           0x01            // Second half mirrors the first
+#define LSPOST_REVERSE          0x02            // End for end
+#define LSPOST_BLUR             0x04            // Blur
+#define LSPOST_DECAY            0x08            // Trails
+
+typedef struct __attribute__((packed)) lspost_s {
+    uint8_t     lp_flags;                       // LSPOST_xxx
+    uint8_t     lp_decay;
+    uint8_t     lp_blur;
+    uint8_t     lp_reserved;
+    uint32_t    lp_strips[MAXVSTRIPS/32];
+} lspost_t;
+
 typedef struct __attribute__((packed)) lsversion_s {
     uint8_t lv_protocol;
     uint8_t lv_major;
@@ -80,6 +119,9 @@ typedef struct __attribute__((packed)) lsmessage_s {
     uint8_t     ls_length;              // number of bytes of payload
     union {                             // payload
         lsanimate_t ls_animate;
+        lsbrightness_t ls_brightness;
+        lsseed_t ls_seed;
+        lspost_t ls_post;
         lsversion_t ls_version;
         lsstatus_t ls_status;
         lspstrip_t ls_pstrip;
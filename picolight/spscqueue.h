@@ -0,0 +1,50 @@
+//
+// spscqueue.h
+// Lock-free single-producer/single-consumer ring buffer, for handing
+// things from one core (or thread) to the other.  N must be a power of
+// two.  Only the producer may call push() and only the consumer pop().
+//
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+
+template <typename T, unsigned N>
+class SpscQueue {
+
+ public:
+
+  SpscQueue() : head(0), tail(0) { }
+
+    bool push(const T &item) {
+      unsigned h = head.load(std::memory_order_relaxed);
+      if ((h - tail.load(std::memory_order_acquire)) == N) return false;     // full
+      items[h & (N - 1)] = item;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T &item) {
+      unsigned t = tail.load(std::memory_order_relaxed);
+      if (t == head.load(std::memory_order_acquire)) return false;           // empty
+      item = items[t & (N - 1)];
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool empty(void) const {
+      return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+ private:
+
+  static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+  T items[N];
+  std::atomic<unsigned>
+    head,          // Next slot the producer fills
+    tail;          // Next slot the consumer empties
+};
+
+#endif // SPSCQUEUE_H
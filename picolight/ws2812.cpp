@@ -39,6 +39,7 @@ int main() {
     ws2812pio_t ws;
 
     ws2812_program_init(&ws, pio0, 0, 800000);
+    ws2812_dma_init(&ws, 1);
 
     Pico_NeoPixel *pnp1 = new Pico_NeoPixel(&ws,WS2812_PIN,16);
     pnp1->begin();
@@ -0,0 +1,321 @@
+//
+// ws2812drv.cpp
+// DMA output path for the ws2812 state machine.  See ws2812drv.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "ws2812drv.h"
+
+static ws2812pio_t ws2812_pool[WS2812_MAX_SM];
+static int ws2812_pool_size = 0;
+static int ws2812_pool_next = 0;
+
+#if PICO_ON_DEVICE
+
+void ws2812_pool_init(float freq)
+{
+    PIO pios[2] = { pio0, pio1 };
+
+    for (int p = 0; p < 2; p++) {
+        if (!pio_can_add_program(pios[p], &ws2812_program)) {
+            continue;
+        }
+        uint offset = pio_add_program(pios[p], &ws2812_program);
+
+        for (;;) {
+            if (ws2812_pool_size == WS2812_MAX_SM) {
+                return;
+            }
+            int sm = pio_claim_unused_sm(pios[p], false);
+            if (sm < 0) {
+                break;
+            }
+            ws2812pio_t *ws = &ws2812_pool[ws2812_pool_size++];
+            ws2812_program_config(ws, pios[p], sm, offset, freq);
+            ws2812_dma_init(ws, 1);
+        }
+    }
+}
+
+void ws2812_pool_stop(void)
+{
+    for (int i = 0; i < ws2812_pool_size; i++) {
+        ws2812_dma_wait(&ws2812_pool[i]);
+        pio_sm_set_enabled(ws2812_pool[i].pio, ws2812_pool[i].sm, false);
+        ws2812_pool[i].pin = -1;
+    }
+}
+
+void ws2812_dma_init(ws2812pio_t *ws, uint width)
+{
+    ws->dma_chan = dma_claim_unused_channel(true);
+
+    // From an incrementing buffer into the (fixed) TX FIFO, paced by the
+    // state machine's TX DREQ.  Byte writes to the FIFO are replicated
+    // across all four byte lanes, so with the OSR shifting left the SM
+    // sees each byte in bits 31:24, MSB first.
+    dma_channel_config c = dma_channel_get_default_config(ws->dma_chan);
+    channel_config_set_transfer_data_size(&c, (width == 1) ? DMA_SIZE_8 : DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(ws->pio, ws->sm, true));
+
+    dma_channel_configure(ws->dma_chan, &c, &(ws->pio->txf[ws->sm]), NULL, 0, false);
+}
+
+// Point the data channel's chain_to at 'chan' (itself for none).
+static void ws2812_dma_chain(ws2812pio_t *ws, uint chan)
+{
+    dma_channel_config c = dma_get_channel_config(ws->dma_chan);
+    channel_config_set_chain_to(&c, chan);
+    dma_channel_set_config(ws->dma_chan, &c, false);
+}
+
+void ws2812_dma_start(ws2812pio_t *ws, const void *src, uint count)
+{
+    if (ws->gather_end) {
+        ws2812_dma_chain(ws, ws->dma_chan);
+        ws->gather_end = NULL;
+    }
+    dma_channel_transfer_from_buffer_now(ws->dma_chan, src, count);
+}
+
+bool ws2812_dma_busy(ws2812pio_t *ws)
+{
+    if (dma_channel_is_busy(ws->dma_chan)) {
+        return true;
+    }
+
+    // Between blocks neither channel may be busy for a moment, so a gather
+    // is only done once the control channel has read the terminator.
+    return ws->gather_end &&
+        (dma_channel_is_busy(ws->gather_chan) ||
+         (dma_hw->ch[ws->gather_chan].read_addr != (uintptr_t) ws->gather_end));
+}
+
+void ws2812_dma_wait(ws2812pio_t *ws)
+{
+    while (ws2812_dma_busy(ws)) {
+        tight_loop_contents();
+    }
+}
+
+bool ws2812_gather_init(ws2812pio_t *ws)
+{
+    if (ws->gather_chan >= 0) {
+        return true;
+    }
+
+    int chan = dma_claim_unused_channel(false);
+    if (chan < 0) {
+        return false;
+    }
+    ws->gather_chan = chan;
+
+    // Each trigger copies one 8-byte list entry into the data channel's
+    // TRANS_COUNT and READ_ADDR_TRIG (alias 3), wrapping the write address
+    // so it lands on the same pair every time.  Writing the read address
+    // starts the block; a NULL there (the terminator) does not.
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 3);
+
+    dma_channel_configure(chan, &c, &dma_hw->ch[ws->dma_chan].al3_transfer_count, NULL, 2, false);
+    return true;
+}
+
+void ws2812_gather_start(ws2812pio_t *ws, const ws2812_gather_t *list)
+{
+    const ws2812_gather_t *end = list;
+
+    while (end->read_addr) {
+        end++;
+    }
+
+    if (!ws->gather_end) {
+        ws2812_dma_chain(ws, ws->gather_chan);
+    }
+    ws->gather_end = end + 1;
+    dma_channel_set_read_addr(ws->gather_chan, list, true);
+}
+
+#else
+
+/*  *********************************************************************
+    *  Software DMA backend for host builds.
+    *
+    *  A transfer is "in flight" until the time it would take to clock
+    *  it out at 800KHz has passed.  When it completes, the data is
+    *  handed to the sink (if any) so a test can inspect what would have
+    *  gone out on the wire.
+    ********************************************************************* */
+
+void ws2812_pool_init(float freq)
+{
+    for (int i = 0; i < WS2812_MAX_SM; i++) {
+        ws2812_host_init(&ws2812_pool[i], i, 10000, NULL);
+        ws2812_dma_init(&ws2812_pool[i], 1);
+    }
+    ws2812_pool_size = WS2812_MAX_SM;
+}
+
+void ws2812_pool_stop(void)
+{
+    for (int i = 0; i < ws2812_pool_size; i++) {
+        ws2812_dma_wait(&ws2812_pool[i]);
+        ws2812_pool[i].pin = -1;
+    }
+}
+
+void ws2812_dma_init(ws2812pio_t *ws, uint width)
+{
+    ws->dma_chan = 0;
+}
+
+static void ws2812_dma_complete(ws2812pio_t *ws)
+{
+    if (ws->sink) {
+        (*ws->sink)(ws, ws->pin, ws->dma_src, ws->dma_count);
+    }
+    ws->dma_src = NULL;
+    ws->dma_count = 0;
+}
+
+void ws2812_dma_start(ws2812pio_t *ws, const void *src, uint count)
+{
+    // Like the hardware, a new transfer is only started once the old
+    // one is done.
+    ws2812_dma_wait(ws);
+
+    ws->dma_src = src;
+    ws->dma_count = count;
+    ws->dma_done = time_us_64() + ((uint64_t) count * ws->xfer_ns) / 1000;
+}
+
+bool ws2812_dma_busy(ws2812pio_t *ws)
+{
+    if (ws->dma_src && (time_us_64() >= ws->dma_done)) {
+        ws2812_dma_complete(ws);
+    }
+    return ws->dma_src != NULL;
+}
+
+void ws2812_dma_wait(ws2812pio_t *ws)
+{
+    while (ws2812_dma_busy(ws)) {
+        tight_loop_contents();
+    }
+}
+
+bool ws2812_gather_init(ws2812pio_t *ws)
+{
+    ws->gather_chan = 0;
+    return true;
+}
+
+// There is no second channel to chain here, so the blocks are copied
+// into one buffer and sent as a single transfer (the sink can't tell).
+void ws2812_gather_start(ws2812pio_t *ws, const ws2812_gather_t *list)
+{
+    const ws2812_gather_t *g;
+    uint total = 0;
+
+    ws2812_dma_wait(ws);
+
+    for (g = list; g->read_addr; g++) {
+        total += g->count;
+    }
+    if (total > ws->gather_size) {
+        ws->gather_buf = (uint8_t *) realloc(ws->gather_buf, total);
+        ws->gather_size = total;
+    }
+
+    uint8_t *p = ws->gather_buf;
+    for (g = list; g->read_addr; g++) {
+        memcpy(p, g->read_addr, g->count);
+        p += g->count;
+    }
+
+    ws2812_dma_start(ws, ws->gather_buf, total);
+}
+
+#endif
+
+
+/*  *********************************************************************
+    *  Channel allocator.  The first WS2812_MAX_SM channels each get a
+    *  state machine of their own; after that they are doubled up.
+    ********************************************************************* */
+
+ws2812pio_t *ws2812_channel_alloc(void)
+{
+    if (ws2812_pool_size == 0) {
+        return NULL;
+    }
+    return &ws2812_pool[ws2812_pool_next++ % ws2812_pool_size];
+}
+
+void ws2812_channel_reset(void)
+{
+    ws2812_pool_next = 0;
+}
+
+
+/*  *********************************************************************
+    *  ws2812_transpose16(out, lanes, laneBytes, nbytes)
+    *
+    *  For each byte position, gather one byte from each lane and turn
+    *  the resulting 16x8 bit matrix on its side, so that output plane k
+    *  holds bit (7-k) of every lane.  Each half (lanes 0-7 and 8-15) is
+    *  an 8x8 transpose done with the 32-bit shuffle from Hacker's
+    *  Delight (transpose8rS32), which suits the M0+ (no 64-bit ops).
+    ********************************************************************* */
+
+static inline void transpose8(uint32_t x, uint32_t y, uint8_t *b)
+{
+    uint32_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+
+    t = (x ^ (x >> 14)) & 0x0000CCCC;  x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC;  y = y ^ t ^ (t << 14);
+
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+    x = t;
+
+    b[0] = x >> 24;  b[1] = x >> 16;  b[2] = x >> 8;  b[3] = x;
+    b[4] = y >> 24;  b[5] = y >> 16;  b[6] = y >> 8;  b[7] = y;
+}
+
+void ws2812_transpose16(uint32_t *out, const uint8_t * const *lanes, const uint16_t *laneBytes, uint nbytes)
+{
+    uint8_t in[WS2812_LANES];
+    uint8_t lo[8], hi[8];
+
+    for (uint j = 0; j < nbytes; j++) {
+        for (int l = 0; l < WS2812_LANES; l++) {
+            in[l] = (lanes[l] && (j < laneBytes[l])) ? lanes[l][j] : 0;
+        }
+
+        // Rows go in highest lane first so that lane N lands in bit N.
+        transpose8(((uint32_t) in[7] << 24) | ((uint32_t) in[6] << 16) | ((uint32_t) in[5] << 8) | in[4],
+                   ((uint32_t) in[3] << 24) | ((uint32_t) in[2] << 16) | ((uint32_t) in[1] << 8) | in[0],
+                   lo);
+        transpose8(((uint32_t) in[15] << 24) | ((uint32_t) in[14] << 16) | ((uint32_t) in[13] << 8) | in[12],
+                   ((uint32_t) in[11] << 24) | ((uint32_t) in[10] << 16) | ((uint32_t) in[9] << 8) | in[8],
+                   hi);
+
+        for (int k = 0; k < 8; k += 2) {
+            *out++ = ((uint32_t) lo[k] | ((uint32_t) hi[k] << 8)) |
+                (((uint32_t) lo[k+1] | ((uint32_t) hi[k+1] << 8)) << 16);
+        }
+    }
+}
@@ -0,0 +1,158 @@
+//
+// ws2812drv.h
+// Output driver underneath Pico_NeoPixel: streams a strip's wire-format
+// data into the ws2812 PIO state machine using DMA so show() can return
+// as soon as the transfer is started.  The ws2812 program autopulls one
+// byte at a time, so the pixel buffer (already in wire order) is DMA'd
+// as-is, 3 or 4 bytes per pixel.
+//
+// On the RP2040 (PICO_ON_DEVICE) this uses a real DMA channel.  For host
+// builds (PICO_PLATFORM=host) there is no PIO or DMA hardware, so a
+// software backend stands in: it "transmits" at the nominal WS2812 rate
+// by timestamp and hands the finished frame to an optional sink callback
+// so the output path can be exercised on Linux.
+//
+
+#ifndef WS2812DRV_H
+#define WS2812DRV_H
+
+#include "pico/stdlib.h"
+
+#if PICO_ON_DEVICE
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "ws2812.pio.h"
+
+#else
+
+typedef struct ws2812pio_s ws2812pio_t;
+
+// Called by the software DMA backend when a transfer completes.
+typedef void (*ws2812_sink_t)(ws2812pio_t *ws, int pin, const void *data, uint count);
+
+struct ws2812pio_s {
+    uint sm;
+    int pin;                    // Pin currently driven by the state machine
+    int dma_chan;
+    int gather_chan;
+    uint8_t *gather_buf;        // Gather list flattened for the sink
+    uint gather_size;
+    const void *dma_src;        // Transfer in flight (NULL if idle)
+    uint dma_count;
+    uint64_t dma_done;          // Time at which the transfer completes
+    uint64_t busy_until;        // When the last bit queued will have gone out
+    uint xfer_ns;               // Wire time of one transfer (FIFO entry)
+    ws2812_sink_t sink;
+};
+
+static inline void ws2812_host_init(ws2812pio_t *ws, uint sm, uint xfer_ns, ws2812_sink_t sink)
+{
+    ws->sm = sm;
+    ws->xfer_ns = xfer_ns;
+    ws->pin = -1;
+    ws->dma_chan = -1;
+    ws->gather_chan = -1;
+    ws->gather_buf = NULL;
+    ws->gather_size = 0;
+    ws->dma_src = NULL;
+    ws->dma_count = 0;
+    ws->dma_done = 0;
+    ws->busy_until = 0;
+    ws->sink = sink;
+}
+
+static inline void ws2812_pin_init(ws2812pio_t *ws, uint pin)
+{
+}
+
+static inline void ws2812_pin_enable(ws2812pio_t *ws, uint pin)
+{
+    ws->pin = pin;
+}
+
+static inline void ws2812_quiesce(ws2812pio_t *ws)
+{
+    while ((int64_t) (time_us_64() - ws->busy_until) < 0) ; // NULL LOOP
+}
+
+static inline void ws2812_parallel_start(ws2812pio_t *ws)
+{
+}
+
+#endif
+
+// Each WS2812 bit is 1.25us at 800KHz, so a byte takes 10us on the wire.
+#define WS2812_US_PER_BYTE      10
+
+// A strip latches its data once its input has been low this long.
+#define WS2812_RESET_US         300
+
+static inline uint64_t ws2812_frame_us(uint nbytes)
+{
+    return (uint64_t) nbytes * WS2812_US_PER_BYTE;
+}
+
+// Claim and configure the DMA channel that feeds ws->sm, moving 'width'
+// bytes (1 for the ws2812 byte stream, 4 for ws2812_parallel) per
+// transfer.
+void ws2812_dma_init(ws2812pio_t *ws, uint width);
+
+// Start streaming 'count' transfers from 'src' to the state machine.
+// Returns immediately; 'src' must be left alone until the DMA is done.
+void ws2812_dma_start(ws2812pio_t *ws, const void *src, uint count);
+
+// True while the DMA channel is still reading from the source buffer.
+bool ws2812_dma_busy(ws2812pio_t *ws);
+
+// Block until the DMA channel has finished reading the source buffer.
+void ws2812_dma_wait(ws2812pio_t *ws);
+
+// A gather list sends a frame from several buffers in turn, without
+// copying them together first: a second DMA channel loads each block's
+// byte count and address into the data channel, which chains back to it
+// when the block is done.  The list ends with { 0, NULL }.
+typedef struct ws2812_gather_s {
+    uint32_t count;             // Bytes in this block
+    const void *read_addr;      // Where they are
+} ws2812_gather_t;
+
+// Claim the control channel for gather lists on 'ws', if not done
+// already.  Returns false if there is no DMA channel left.
+bool ws2812_gather_init(ws2812pio_t *ws);
+
+// Start sending 'list' (which, like every block in it, must be left
+// alone until the DMA is done).  ws2812_dma_busy()/ws2812_dma_wait()
+// cover the whole list.
+void ws2812_gather_start(ws2812pio_t *ws, const ws2812_gather_t *list);
+
+// Up to this many state machines (4 per PIO block) are handed out to
+// physical channels, each with its own DMA channel, so channels of
+// different lengths transmit concurrently.  Any further channels share
+// state machines round-robin and go out one after another.
+#define WS2812_MAX_SM           8
+
+// Load the ws2812 program into pio0 and pio1 and claim every free state
+// machine (up to WS2812_MAX_SM) for the channel allocator.
+void ws2812_pool_init(float freq);
+
+// Hand out the next state machine for a physical channel.
+ws2812pio_t *ws2812_channel_alloc(void);
+
+// Forget all allocations; the next ws2812_channel_alloc() starts over.
+void ws2812_channel_reset(void);
+
+// Stop every pool state machine, e.g. before another program takes
+// over their pins.
+void ws2812_pool_stop(void);
+
+// Number of lanes driven by the ws2812_parallel program.
+#define WS2812_LANES            16
+
+// Bit-transpose 'nbytes' bytes of up to 16 lane buffers into the
+// ws2812_parallel FIFO format: 4 words per byte, each word holding two
+// 16-bit planes (MSB plane first, low half first), bit N = lane N.
+// Lanes with a NULL source, or shorter than nbytes, are padded with 0.
+void ws2812_transpose16(uint32_t *out, const uint8_t * const *lanes, const uint16_t *laneBytes, uint nbytes);
+
+#endif // WS2812DRV_H
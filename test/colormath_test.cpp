@@ -0,0 +1,189 @@
+//
+// colormath_test.cpp
+// Host check and benchmark for the fixed-point color math in Ala.h.
+// scale8(), interpolate8() and getPalColor16() are compared with the
+// float scale(), interpolate() and getPalColor() they replace, and must
+// stay within MAX_ERROR of them on every channel.  Then the per-LED
+// work of a palette animation is timed both ways.
+//
+// Exits non-zero if an error bound is exceeded.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "Ala.h"
+
+// A Q8 factor is up to 1/256 short of the float it stands for, which
+// costs at most 1 on a channel.  Otherwise both round down alike.
+#define MAX_ERROR       1
+
+#define RANDOM_SAMPLES  (1 << 20)
+
+#define BENCH_LEDS      1000
+#define BENCH_FRAMES    200
+
+static AlaPalette *palettes[] = {
+    &alaPalRgb, &alaPalRainbow, &alaPalRainbowStripe, &alaPalParty,
+    &alaPalHeat, &alaPalFire, &alaPalCool
+};
+#define NUM_PALETTES    (int) (sizeof(palettes) / sizeof(palettes[0]))
+
+// Largest difference between any two channels of a and b.
+static int colorError(AlaColor a, AlaColor b)
+{
+    int e = abs(a.r - b.r);
+
+    if (abs(a.g - b.g) > e) e = abs(a.g - b.g);
+    if (abs(a.b - b.b) > e) e = abs(a.b - b.b);
+    return e;
+}
+
+static int report(const char *what, int worst)
+{
+    printf("%-16s worst error %d/255%s\n", what, worst, (worst > MAX_ERROR) ? "  FAILED" : "");
+    return (worst > MAX_ERROR) ? 1 : 0;
+}
+
+// A random factor from 0 to 1, and the Q8 a kernel would use for it.
+static float randomFactor(int *q8)
+{
+    float k = (float) rand() / RAND_MAX;
+
+    *q8 = (int) (k * ALA_Q8_ONE);
+    return k;
+}
+
+/*  *********************************************************************
+    *  Differential checks.  Each is run on every Q8 factor with a spread
+    *  of channel values, then on random float factors as the kernels
+    *  convert them.  The palettes are checked at positions that don't
+    *  fall on the Q8 steps between colors.
+    ********************************************************************* */
+
+static int checkScale(void)
+{
+    int worst = 0;
+
+    for (int v = 0; v < 256; v++) {
+        for (int k = 0; k <= 2 * ALA_Q8_ONE; k++) {
+            AlaColor c(v, 255 - v, v / 2);
+            int e = colorError(c.scale8(k), c.scale((float) k / ALA_Q8_ONE));
+            if (e > worst) worst = e;
+        }
+    }
+    for (int i = 0; i < RANDOM_SAMPLES; i++) {
+        AlaColor c(rand(), rand(), rand());
+        int k8;
+        float k = randomFactor(&k8);
+        int e = colorError(c.scale8(k8), c.scale(k));
+        if (e > worst) worst = e;
+    }
+    return report("scale8", worst);
+}
+
+static int checkInterpolate(void)
+{
+    int worst = 0;
+
+    for (int a = 0; a < 256; a++) {
+        for (int b = 0; b < 256; b++) {
+            AlaColor ca(a, b, 255 - a), cb(b, a, 255 - b);
+            for (int x = 0; x <= ALA_Q8_ONE; x++) {
+                int e = colorError(ca.interpolate8(cb, x), ca.interpolate(cb, (float) x / ALA_Q8_ONE));
+                if (e > worst) worst = e;
+            }
+        }
+    }
+    for (int i = 0; i < RANDOM_SAMPLES; i++) {
+        AlaColor ca(rand(), rand(), rand()), cb(rand(), rand(), rand());
+        int x8;
+        float x = randomFactor(&x8);
+        int e = colorError(ca.interpolate8(cb, x8), ca.interpolate(cb, x));
+        if (e > worst) worst = e;
+    }
+    return report("interpolate8", worst);
+}
+
+static int checkPalette(void)
+{
+    int worst = 0;
+
+    for (int p = 0; p < NUM_PALETTES; p++) {
+        AlaPalette *pal = palettes[p];
+        for (alaq16_t i = 0; i < (pal->numColors << 16); i += 37) {
+            int e = colorError(pal->getPalColor16(i), pal->getPalColor((float) i / ALA_Q16_ONE));
+            if (e > worst) worst = e;
+        }
+    }
+    return report("getPalColor16", worst);
+}
+
+/*  *********************************************************************
+    *  benchmark()
+    *
+    *  What a palette animation does for each LED: look up its color
+    *  part way along the palette and scale it to a brightness.  The
+    *  float and fixed-point loops walk the same positions.
+    ********************************************************************* */
+
+static volatile uint32_t sink;
+
+static void benchmark(void)
+{
+    AlaPalette pal = alaPalRainbow;
+    uint64_t t0, tFloat, tFixed;
+    uint32_t sum;
+
+    // Same step along the palette and brightness ramp for both.
+    alaq16_t step = (pal.numColors << 16) / BENCH_LEDS;
+
+    sum = 0;
+    t0 = time_us_64();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        float pos = (float) f / BENCH_FRAMES;
+        float k = 0.5f;
+        for (int x = 0; x < BENCH_LEDS; x++) {
+            AlaColor c = pal.getPalColor(pos).scale(k);
+            sum += c.raw[0] + c.raw[1] + c.raw[2];
+            pos += (float) step / ALA_Q16_ONE;
+            k += 0.5f / BENCH_LEDS;
+        }
+    }
+    tFloat = time_us_64() - t0;
+    sink = sum;
+
+    sum = 0;
+    t0 = time_us_64();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        alaq16_t pos = (f << 16) / BENCH_FRAMES;
+        alaq16_t k = ALA_Q16_ONE / 2;
+        for (int x = 0; x < BENCH_LEDS; x++) {
+            AlaColor c = pal.getPalColor16(pos).scale8(alaClampQ8(k));
+            sum += c.raw[0] + c.raw[1] + c.raw[2];
+            pos += step;
+            k += (ALA_Q16_ONE / 2) / BENCH_LEDS;
+        }
+    }
+    tFixed = time_us_64() - t0;
+    sink = sum;
+
+    printf("per LED: float %.1f ns, fixed point %.1f ns (%.1fx)\n",
+           tFloat * 1000.0 / (BENCH_FRAMES * BENCH_LEDS),
+           tFixed * 1000.0 / (BENCH_FRAMES * BENCH_LEDS),
+           (double) tFloat / (tFixed ? tFixed : 1));
+}
+
+int main(void)
+{
+    int failed = 0;
+
+    srand(1);
+    failed += checkScale();
+    failed += checkInterpolate();
+    failed += checkPalette();
+    benchmark();
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+//
+// pack_test.cpp
+// Host check and benchmark for streaming the pixel buffer to the PIO as
+// bytes.  The packing loop show() used to run (each pixel's three bytes
+// repacked into a word with urgb_u32(), then the words DMA'd) is kept
+// here as the reference.  For each strip length, the bytes show() now
+// sends must be the ones the old words carried, top byte first, and
+// the CPU time spent in each per frame is printed.
+//
+// Exits non-zero if the byte stream differs.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "pico/stdlib.h"
+#include "PicoNeoPixel.h"
+
+#define BENCH_FRAMES    50      // Each waits out the real wire time
+
+static const int lengths[] = { 60, 300, 1000 };
+#define NUM_LENGTHS     (int) (sizeof(lengths) / sizeof(lengths[0]))
+
+static uint8_t sent[3 * 1000];
+static uint sentBytes;
+
+static void sink(ws2812pio_t *ws, int pin, const void *data, uint count)
+{
+    memcpy(sent, data, count);
+    sentBytes = count;
+}
+
+static inline uint32_t urgb_u32(uint8_t b0, uint8_t b1, uint8_t b2) {
+    return
+            ((uint32_t) (b0) << 16) |
+            ((uint32_t) (b1) << 8) |
+            (uint32_t) (b2);
+}
+
+// The old show(), from the pixel buffer on: pack, then start the DMA.
+static void packedShow(ws2812pio_t *ws, const uint8_t *pixels, uint32_t *words, uint count)
+{
+    const uint8_t *pptr = pixels;
+    uint32_t *wptr = words;
+
+    for (uint i = 0; i < count; i++) {
+        *wptr++ = (urgb_u32(pptr[0], pptr[1], pptr[2])) << 8u;
+        pptr += 3;
+    }
+    ws2812_dma_start(ws, words, count);
+}
+
+// The host's microsecond timer is too coarse for a single show().
+static inline uint64_t nowNs(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(void)
+{
+    ws2812pio_t wsbyte, wsword;
+    int errors = 0;
+
+    // Transfers take no time to speak of, so only the CPU work counts.
+    ws2812_host_init(&wsbyte, 0, 1, sink);
+    ws2812_dma_init(&wsbyte, 1);
+    ws2812_host_init(&wsword, 1, 1, NULL);
+    ws2812_dma_init(&wsword, 4);
+
+    srand(1);
+    for (int l = 0; l < NUM_LENGTHS; l++) {
+        int n = lengths[l];
+        Pico_NeoPixel strip(&wsbyte, 0, n, NEO_GRB);
+        uint32_t *words = (uint32_t *) malloc(n * sizeof(uint32_t));
+        uint64_t t0, tPacked = 0, tBytes = 0;
+
+        strip.begin();
+        for (int f = 0; f < BENCH_FRAMES; f++) {
+            // A new color for every pixel, so the whole strip goes out.
+            for (int x = 0; x < n; x++) {
+                strip.setPixelColor(x, rand(), rand(), rand());
+            }
+
+            ws2812_dma_wait(&wsword);
+            t0 = nowNs();
+            packedShow(&wsword, strip.getPixels(), words, n);
+            tPacked += nowNs() - t0;
+
+            while (!strip.canShow()) ;
+            t0 = nowNs();
+            strip.show();
+            tBytes += nowNs() - t0;
+
+            // Both sent the same bits?
+            ws2812_dma_wait(&wsbyte);
+            bool same = (sentBytes == (uint) n * 3);
+            for (int x = 0; same && (x < n); x++) {
+                same = (sent[3*x]   == (uint8_t) (words[x] >> 24)) &&
+                       (sent[3*x+1] == (uint8_t) (words[x] >> 16)) &&
+                       (sent[3*x+2] == (uint8_t) (words[x] >> 8));
+            }
+            if (!same) {
+                if (errors < 10) {
+                    printf("%d LEDs, frame %d: byte stream differs from the packed words\n", n, f);
+                }
+                errors++;
+            }
+        }
+
+        printf("%4d LEDs: packing loop %.2f us, byte stream %.2f us per frame\n", n,
+               tPacked / (1000.0 * BENCH_FRAMES), tBytes / (1000.0 * BENCH_FRAMES));
+
+        ws2812_dma_wait(&wsword);
+        free(words);
+    }
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+//
+// pipe_test.cpp
+// Host check for Pico_NeoPixelPipe.  Core1's output loop runs on a
+// std::thread (see picocore.cpp) while this thread, as core0, draws
+// random changes into four double-buffered strips and submits them.
+// The strips share two software state machines, whose sink records
+// every frame that goes out.
+//
+// Each strip's model follows what commit() should fix as a frame: the
+// pixels up to the highest one changed since the last commit.  Every
+// committed frame must reach the sink once, in order, with exactly
+// those bytes.  Exits non-zero if one doesn't.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "pico/stdlib.h"
+#include "PicoNeoPixelPipe.h"
+
+#define STRIPS          4
+#define LEDS            30
+#define FRAMES          3000
+#define BASE_PIN        6
+
+typedef std::vector<uint8_t> frame_t;
+
+static frame_t committed[STRIPS][FRAMES];      // Written by core0
+static int numCommitted[STRIPS];
+static frame_t sent[STRIPS][FRAMES];           // Written by the sink (core1)
+static int numSent[STRIPS];
+static int overflow;
+
+static void sink(ws2812pio_t *ws, int pin, const void *data, uint count)
+{
+    int s = pin - BASE_PIN;
+
+    if ((s < 0) || (s >= STRIPS) || (numSent[s] >= FRAMES)) {
+        overflow++;
+        return;
+    }
+    sent[s][numSent[s]++].assign((const uint8_t *) data, (const uint8_t *) data + count);
+}
+
+int main(void)
+{
+    ws2812pio_t ws[2];
+    Pico_NeoPixel *strips[STRIPS];
+    uint8_t model[STRIPS][LEDS * 3];            // GRB, as on the wire
+    int dirtyEnd[STRIPS];
+    int errors = 0;
+
+    // 1us a byte keeps the run short; the latch is still the real 300us.
+    for (int i = 0; i < 2; i++) {
+        ws2812_host_init(&ws[i], i, 1000, sink);
+        ws2812_dma_init(&ws[i], 1);
+    }
+    for (int s = 0; s < STRIPS; s++) {
+        strips[s] = new Pico_NeoPixel(&ws[s % 2], BASE_PIN + s, LEDS, NEO_GRB);
+        strips[s]->setKeepAlive(0);
+        strips[s]->setDoubleBuffered(true);
+        strips[s]->begin();
+        memset(model[s], 0, sizeof(model[s]));
+        dirtyEnd[s] = LEDS;                     // A new strip is all dirty
+    }
+
+    Pico_NeoPixelPipe::start();
+
+    srand(1);
+    for (int f = 0; f < FRAMES; f++) {
+        for (int s = 0; s < STRIPS; s++) {
+            // Change a few pixels anywhere on the strip.
+            for (int n = rand() % 4; n > 0; n--) {
+                int x = rand() % LEDS;
+                uint8_t r = rand(), g = rand(), b = rand();
+                uint8_t *p = &model[s][x * 3];
+                strips[s]->setPixelColor(x, r, g, b);
+                if ((p[0] != g) || (p[1] != r) || (p[2] != b)) {
+                    p[0] = g;  p[1] = r;  p[2] = b;
+                    if (x >= dirtyEnd[s]) dirtyEnd[s] = x + 1;
+                }
+            }
+
+            Pico_NeoPixelPipe::submit(strips[s]);
+
+            // With no keep-alive, the strip is clean only if that
+            // submit() committed it.
+            if (dirtyEnd[s] && !strips[s]->needsShow()) {
+                committed[s][numCommitted[s]++].assign(model[s], model[s] + dirtyEnd[s] * 3);
+                dirtyEnd[s] = 0;
+            }
+        }
+        sleep_us(rand() % 200);
+    }
+
+    // Everything has latched; the sink gets the last transfers once
+    // their state machines are polled.
+    Pico_NeoPixelPipe::drain();
+    for (int i = 0; i < 2; i++) {
+        ws2812_dma_wait(&ws[i]);
+    }
+
+    for (int s = 0; s < STRIPS; s++) {
+        if (numSent[s] != numCommitted[s]) {
+            printf("strip %d: %d frames committed, %d sent\n", s, numCommitted[s], numSent[s]);
+            errors++;
+        }
+        for (int f = 0; (f < numSent[s]) && (f < numCommitted[s]); f++) {
+            if (sent[s][f] != committed[s][f]) {
+                if (errors < 10) {
+                    printf("strip %d: frame %d went out wrong (%u bytes, %u expected)\n",
+                           s, f, (unsigned) sent[s][f].size(), (unsigned) committed[s][f].size());
+                }
+                errors++;
+            }
+        }
+        printf("strip %d: %d frames committed and checked\n", s, numCommitted[s]);
+    }
+    if (overflow) {
+        printf("%d unexpected transfers\n", overflow);
+        errors++;
+    }
+
+    return errors ? 1 : 0;
+}
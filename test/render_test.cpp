@@ -0,0 +1,197 @@
+//
+// render_test.cpp
+// Host check for rendering on both cores (MULTICORE_RENDER in
+// picolight.cpp).  The same logical strips are run twice over the same
+// frame times: once rendered and shown on this thread alone, and once
+// split between the cores the way planRender() does it, with core1 (a
+// std::thread, see picocore.cpp) running the output pipe's loop so it
+// is sending strips and rendering in the same loop.  After every frame's blit
+// the physical strips' pixel buffers must match byte for byte.  Exits
+// non-zero if they don't.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "pico/stdlib.h"
+#include "picocore.h"
+#include "AlaLedRgb.h"
+#include "PicoNeoPixelPipe.h"
+
+#define PSTRIPS         3
+#define PLEDS           100
+#define VSTRIPS         10
+#define VLEDS           30      // VSTRIPS * VLEDS fit on the physical strips
+#define FRAMES          300
+#define FRAME_US        7000
+
+extern AlaPalette alaPalRainbow, alaPalParty, alaPalFire;
+
+// One animation per logical strip, covering the kernels with random
+// numbers, particles and state carried between frames.
+static const struct {
+    int animation;
+    long speed;
+    unsigned int option;
+    AlaPalette *palette;
+    unsigned int post;
+} setups[VSTRIPS] = {
+    { ALA_PLASMA,               3000, 0,      &alaPalRainbow, 0 },
+    { ALA_SPARKLE,              1000, 0,      &alaPalParty,   0 },
+    { ALA_SPARKLE2,             1000, 0,      &alaPalRainbow, 0 },
+    { ALA_FLAME,                1000, 0,      &alaPalFire,    0 },
+    { ALA_BOUNCINGBALLS,        2000, 0,      &alaPalRainbow, 0 },
+    { ALA_BUBBLES,              2000, 0,      &alaPalParty,   0 },
+    { ALA_COMETCOL,             1500, 0,      &alaPalRainbow, 0 },
+    { ALA_LARSONSCANNER,        1200, 0,      &alaPalFire,    ALA_POST_DECAY | ALA_POST_BLUR },
+    { ALA_PIXELSMOOTHBOUNCE,    2500, 0,      &alaPalParty,   0 },
+    { ALA_FADECOLORSLOOP,       2000, 0,      &alaPalRainbow, ALA_POST_MIRROR },
+};
+
+typedef std::vector<uint8_t> frame_t;
+
+// Which strips core1 renders, as in picolight.cpp.
+typedef struct {
+    int count;
+    AlaLedRgb *strips[VSTRIPS];
+} RenderList_t;
+
+static uint64_t frameTime;
+
+static void renderJob(void *arg)
+{
+    RenderList_t *list = (RenderList_t *) arg;
+
+    for (int i = 0; i < list->count; i++) {
+        list->strips[i]->render(frameTime);
+    }
+}
+
+/*  *********************************************************************
+    *  run(twoCores, out)
+    *
+    *  Set up the strips from scratch and run FRAMES frames, appending
+    *  every physical strip's pixels after each blit to 'out'.
+    ********************************************************************* */
+
+static void run(bool twoCores, std::vector<frame_t> &out)
+{
+    ws2812pio_t ws[PSTRIPS];
+    Pico_NeoPixel *pstrips[PSTRIPS];
+    AlaLedRgb *vstrips[VSTRIPS];
+    RenderList_t lists[2];
+    uint64_t start = 1000000;
+
+    for (int p = 0; p < PSTRIPS; p++) {
+        ws2812_host_init(&ws[p], p, 1000, NULL);
+        ws2812_dma_init(&ws[p], 1);
+        pstrips[p] = new Pico_NeoPixel(&ws[p], p, PLEDS, NEO_GRB);
+        pstrips[p]->setDoubleBuffered(true);
+        pstrips[p]->begin();
+    }
+
+    // Laid end to end over the physical strips, every other one
+    // reversed, so some are split across two of them.
+    alaParticlePoolInit(VSTRIPS);
+    for (int v = 0; v < VSTRIPS; v++) {
+        int first = v * VLEDS;
+        int left = VLEDS;
+
+        vstrips[v] = new AlaLedRgb();
+        while (left > 0) {
+            int p = first / PLEDS;
+            int n = PLEDS - (first % PLEDS);
+            if (n > left) n = left;
+            vstrips[v]->addSubStrip(first % PLEDS, n, (v & 1) != 0, pstrips[p]);
+            first += n;
+            left -= n;
+        }
+        vstrips[v]->begin();
+        vstrips[v]->setSeed(1234 + v);
+        vstrips[v]->setRefreshRate((v % 3) ? 100 : 60);
+        vstrips[v]->forceAnimation(setups[v].animation, setups[v].speed, v & 1,
+                                   setups[v].option, *setups[v].palette, AlaColor(0x40C020));
+        vstrips[v]->setStartTime(start);
+        if (setups[v].post)
+            vstrips[v]->setPostProcess(setups[v].post, 0, 0);
+    }
+
+    // Most expensive first, each to the less loaded core (planRender()).
+    lists[0].count = lists[1].count = 0;
+    if (twoCores) {
+        int load[2] = { 0, 0 };
+        bool placed[VSTRIPS] = { false };
+        for (int n = 0; n < VSTRIPS; n++) {
+            int best = -1;
+            for (int v = 0; v < VSTRIPS; v++) {
+                if (!placed[v] && ((best < 0) ||
+                    (vstrips[v]->getRenderCost() > vstrips[best]->getRenderCost())))
+                    best = v;
+            }
+            placed[best] = true;
+            int core = (load[1] < load[0]) ? 1 : 0;
+            lists[core].strips[lists[core].count++] = vstrips[best];
+            load[core] += vstrips[best]->getRenderCost();
+        }
+    } else {
+        for (int v = 0; v < VSTRIPS; v++)
+            lists[0].strips[lists[0].count++] = vstrips[v];
+    }
+
+    for (int f = 0; f < FRAMES; f++) {
+        frameTime = start + (uint64_t) f * FRAME_US;
+
+        if (twoCores) {
+            core1_post(renderJob, &lists[1]);
+            renderJob(&lists[0]);
+            core1_wait();
+        } else {
+            renderJob(&lists[0]);
+        }
+
+        for (int v = 0; v < VSTRIPS; v++)
+            vstrips[v]->blit();
+
+        for (int p = 0; p < PSTRIPS; p++) {
+            const uint8_t *px = pstrips[p]->getPixels();
+            out.push_back(frame_t(px, px + pstrips[p]->getNumBytes()));
+            if (twoCores)
+                Pico_NeoPixelPipe::submit(pstrips[p]);
+            else
+                pstrips[p]->show();
+        }
+    }
+
+    if (twoCores)
+        Pico_NeoPixelPipe::drain();
+    for (int v = 0; v < VSTRIPS; v++)
+        delete vstrips[v];
+    for (int p = 0; p < PSTRIPS; p++)
+        delete pstrips[p];
+}
+
+int main(void)
+{
+    std::vector<frame_t> one, two;
+    int errors = 0;
+
+    run(false, one);
+    Pico_NeoPixelPipe::start();
+    run(true, two);
+
+    for (size_t i = 0; i < one.size(); i++) {
+        if ((i >= two.size()) || (one[i] != two[i])) {
+            if (errors < 10) {
+                printf("frame %d, physical strip %d differs\n",
+                       (int) (i / PSTRIPS), (int) (i % PSTRIPS));
+            }
+            errors++;
+        }
+    }
+    printf("%d frames of %d physical strips compared, %d different\n",
+           FRAMES, PSTRIPS, errors);
+
+    return errors ? 1 : 0;
+}
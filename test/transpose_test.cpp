@@ -0,0 +1,194 @@
+//
+// transpose_test.cpp
+// Host check and benchmark for the 16-lane parallel output (see
+// PicoNeoPixelBank.h).  ws2812_transpose16() is compared bit for bit
+// with a plain reference transpose, then a frame for 16 strips is sent
+// both ways: one strip after another through a single state machine
+// (the sequential path) and all at once through Pico_NeoPixelBank.
+// The host DMA backend clocks transfers out at the WS2812 rate, so the
+// frame times are what the wire would take.
+//
+// Exits non-zero if the transpose is wrong.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "PicoNeoPixel.h"
+#include "PicoNeoPixelBank.h"
+
+#define MAX_BYTES       600     // Longest lane in the check, in bytes
+#define BENCH_LEDS      100     // Pixels per strip in the benchmark
+#define BENCH_FRAMES    10
+#define BASE_PIN        6       // GPIO of lane 0 (PORT_B1)
+
+/*  *********************************************************************
+    *  referenceTranspose(out, lanes, laneBytes, nbytes)
+    *
+    *  What ws2812_transpose16() should produce, one bit at a time:
+    *  plane k of byte j holds bit (7-k) of byte j of every lane, and
+    *  each output word holds two planes, the earlier one in the low half.
+    ********************************************************************* */
+
+static void referenceTranspose(uint32_t *out, const uint8_t * const *lanes, const uint16_t *laneBytes, uint nbytes)
+{
+    memset(out, 0, 4 * nbytes * sizeof(uint32_t));
+
+    for (uint j = 0; j < nbytes; j++) {
+        for (int l = 0; l < WS2812_LANES; l++) {
+            if (!lanes[l] || (j >= laneBytes[l])) {
+                continue;
+            }
+            for (int k = 0; k < 8; k++) {
+                if (lanes[l][j] & (0x80 >> k)) {
+                    out[4*j + k/2] |= 1u << (l + 16*(k & 1));
+                }
+            }
+        }
+    }
+}
+
+/*  *********************************************************************
+    *  checkTranspose()
+    *
+    *  Random lane contents and lengths, with some lanes missing, over a
+    *  range of frame lengths.  Returns the number of mismatched words.
+    ********************************************************************* */
+
+static int checkTranspose(void)
+{
+    static uint8_t data[WS2812_LANES][MAX_BYTES];
+    static uint32_t got[4 * MAX_BYTES], want[4 * MAX_BYTES];
+    const uint8_t *lanes[WS2812_LANES];
+    uint16_t laneBytes[WS2812_LANES];
+    int errors = 0;
+
+    srand(1);
+    for (int pass = 0; pass < 200; pass++) {
+        uint nbytes = 1 + rand() % MAX_BYTES;
+
+        for (int l = 0; l < WS2812_LANES; l++) {
+            for (int j = 0; j < MAX_BYTES; j++) {
+                data[l][j] = rand();
+            }
+            lanes[l] = (rand() % 8) ? data[l] : NULL;
+            laneBytes[l] = rand() % (MAX_BYTES + 1);
+        }
+
+        // Every bit set and every lane full length once, to catch a
+        // lane landing in the wrong bit.
+        if (pass == 0) {
+            nbytes = MAX_BYTES;
+            for (int l = 0; l < WS2812_LANES; l++) {
+                memset(data[l], 0xFF, MAX_BYTES);
+                lanes[l] = data[l];
+                laneBytes[l] = MAX_BYTES;
+            }
+        }
+
+        ws2812_transpose16(got, lanes, laneBytes, nbytes);
+        referenceTranspose(want, lanes, laneBytes, nbytes);
+
+        for (uint i = 0; i < 4 * nbytes; i++) {
+            if (got[i] != want[i]) {
+                if (errors < 10) {
+                    printf("pass %d, %u bytes: word %u is %08x, should be %08x\n",
+                           pass, nbytes, i, got[i], want[i]);
+                }
+                errors++;
+            }
+        }
+    }
+
+    return errors;
+}
+
+// Give every pixel of every strip a new color, so each frame is sent in
+// full.
+static void paint(Pico_NeoPixel **strips, int frame)
+{
+    for (int l = 0; l < WS2812_LANES; l++) {
+        for (int x = 0; x < BENCH_LEDS; x++) {
+            strips[l]->setPixelColor(x, frame, l, x);
+        }
+    }
+}
+
+/*  *********************************************************************
+    *  benchmark()
+    *
+    *  For each path, the CPU time spent in show() and the time until
+    *  the last bit of the frame is on the wire, averaged over
+    *  BENCH_FRAMES frames.
+    ********************************************************************* */
+
+static void benchmark(void)
+{
+    ws2812pio_t wsseq, wspar;
+    Pico_NeoPixel *seq[WS2812_LANES], *par[WS2812_LANES];
+    uint64_t cpu, wire, transpose, t0;
+
+    // One byte per transfer on the sequential state machine, one 2-bit
+    // word per transfer on the parallel one.
+    ws2812_host_init(&wsseq, 0, 1000 * WS2812_US_PER_BYTE, NULL);
+    ws2812_dma_init(&wsseq, 1);
+    ws2812_host_init(&wspar, 1, 1000 * WS2812_US_PER_BYTE / 4, NULL);
+    ws2812_dma_init(&wspar, 4);
+
+    Pico_NeoPixelBank bank(&wspar, BASE_PIN);
+
+    for (int l = 0; l < WS2812_LANES; l++) {
+        seq[l] = new Pico_NeoPixel(&wsseq, BASE_PIN + l, BENCH_LEDS, NEO_GRB);
+        seq[l]->begin();
+        par[l] = new Pico_NeoPixel(&wspar, BASE_PIN + l, BENCH_LEDS, NEO_GRB);
+        par[l]->begin();
+        bank.attach(par[l]);
+    }
+
+    cpu = wire = 0;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        paint(seq, f);
+        t0 = time_us_64();
+        for (int l = 0; l < WS2812_LANES; l++) {
+            seq[l]->show();
+        }
+        cpu += time_us_64() - t0;
+        while (seq[WS2812_LANES-1]->isShowing()) ;
+        wire += time_us_64() - t0;
+        while (!seq[WS2812_LANES-1]->canShow()) ;
+    }
+    printf("sequential: %llu us in show(), %llu us on the wire per frame\n",
+           cpu / BENCH_FRAMES, wire / BENCH_FRAMES);
+
+    cpu = wire = transpose = 0;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        paint(par, f);
+        t0 = time_us_64();
+        bank.show();
+        cpu += time_us_64() - t0;
+        transpose += bank.getTransposeTime();
+        while (bank.isShowing()) ;
+        wire += time_us_64() - t0;
+        while (!bank.canShow()) ;
+    }
+    printf("parallel:   %llu us in show() (%llu us transposing), %llu us on the wire per frame\n",
+           cpu / BENCH_FRAMES, transpose / BENCH_FRAMES, wire / BENCH_FRAMES);
+
+    ws2812_dma_wait(&wsseq);
+    for (int l = 0; l < WS2812_LANES; l++) {
+        delete seq[l];
+        delete par[l];
+    }
+}
+
+int main(void)
+{
+    int errors = checkTranspose();
+
+    printf("transpose: %d mismatched words\n", errors);
+    benchmark();
+
+    return errors ? 1 : 0;
+}